@@ -0,0 +1,321 @@
+/**
+ * @file Arduino.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ */
+
+#include "Arduino.h"
+#include <time.h>
+#include <ctype.h>
+#include <sched.h>
+
+HardwareSerial Serial;
+
+// Stores the moment the program started.
+static struct timespec startTime = []() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts;
+}();
+
+static uint64_t elapsedMicros(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)(now.tv_sec - startTime.tv_sec) * 1000000ULL + (now.tv_nsec - startTime.tv_nsec) / 1000;
+}
+
+unsigned long millis(void) {
+  return (unsigned long)(elapsedMicros() / 1000);
+}
+
+unsigned long micros(void) {
+  return (unsigned long)elapsedMicros();
+}
+
+void delay(unsigned long ms) {
+  usleep(ms * 1000);
+}
+
+void yield(void) {
+  sched_yield();
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) srandom(seed);
+}
+
+long random(long max) {
+  if (max == 0) return 0;
+  return ::random() % max;
+}
+
+long random(long min, long max) {
+  if (min >= max) return min;
+  return min + random(max - min);
+}
+
+String::String(const char* str) : _str(str ? str : ""), _invalid(str == NULL) {}
+
+String::String(const char* str, size_t length) : _str(str, length), _invalid(false) {}
+
+String::String(const std::string& str) : _str(str), _invalid(false) {}
+
+String::String(char c) : _str(1, c), _invalid(false) {}
+
+// Formats an integer in the given base the way the Arduino core does.
+static std::string formatInteger(unsigned long long value, bool negative, unsigned char base) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  char* p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  do {
+    int digit = value % base;
+    *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  return p;
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) : _invalid(false) {
+  bool negative = value < 0 && base == 10;
+  _str = formatInteger(negative ? -(unsigned long long)value : (unsigned long)value, negative, base);
+}
+
+String::String(unsigned long value, unsigned char base) : _str(formatInteger(value, false, base)), _invalid(false) {}
+
+String::String(double value, unsigned char decimalPlaces) : _invalid(false) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  _str = buf;
+}
+
+bool String::reserve(unsigned int size) {
+  _str.reserve(size);
+  return true;
+}
+
+String& String::operator+=(const String& rhs) {
+  _str += rhs._str;
+  _invalid = false;
+  return *this;
+}
+
+String& String::operator+=(const char* rhs) {
+  if (rhs) _str += rhs;
+  _invalid = false;
+  return *this;
+}
+
+String& String::operator+=(char rhs) {
+  _str += rhs;
+  _invalid = false;
+  return *this;
+}
+
+String& String::operator+=(int rhs) { return *this += String(rhs); }
+
+String& String::operator+=(unsigned int rhs) { return *this += String(rhs); }
+
+String& String::operator+=(long rhs) { return *this += String(rhs); }
+
+String& String::operator+=(unsigned long rhs) { return *this += String(rhs); }
+
+String& String::operator+=(double rhs) { return *this += String(rhs); }
+
+bool String::concat(const char* str, unsigned int length) {
+  _str.append(str, length);
+  _invalid = false;
+  return true;
+}
+
+char String::operator[](unsigned int index) const {
+  return index < _str.length() ? _str[index] : '\0';
+}
+
+char& String::operator[](unsigned int index) {
+  static char dummy;
+  if (index >= _str.length()) {
+    dummy = '\0';
+    return dummy;
+  }
+  return _str[index];
+}
+
+bool String::equalsIgnoreCase(const String& rhs) const {
+  if (_str.length() != rhs._str.length()) return false;
+  for (size_t i = 0; i < _str.length(); i++) {
+    if (tolower((unsigned char)_str[i]) != tolower((unsigned char)rhs._str[i])) return false;
+  }
+  return true;
+}
+
+bool String::startsWith(const String& prefix) const {
+  return _str.compare(0, prefix._str.length(), prefix._str) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+  if (suffix._str.length() > _str.length()) return false;
+  return _str.compare(_str.length() - suffix._str.length(), suffix._str.length(), suffix._str) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t pos = _str.find(c, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String& str, unsigned int from) const {
+  size_t pos = _str.find(str._str, from);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int from) const {
+  return substring(from, _str.length());
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) std::swap(from, to);
+  if (from >= _str.length()) return String("");
+  return String(_str.substr(from, std::min<size_t>(to, _str.length()) - from));
+}
+
+void String::remove(unsigned int index) {
+  if (index < _str.length()) _str.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+  if (index < _str.length()) _str.erase(index, count);
+}
+
+void String::trim(void) {
+  size_t begin = 0;
+  size_t end = _str.length();
+  while (begin < end && isspace((unsigned char)_str[begin])) begin++;
+  while (end > begin && isspace((unsigned char)_str[end - 1])) end--;
+  _str = _str.substr(begin, end - begin);
+}
+
+void String::toLowerCase(void) {
+  for (size_t i = 0; i < _str.length(); i++) _str[i] = tolower((unsigned char)_str[i]);
+}
+
+long String::toInt(void) const {
+  return atol(_str.c_str());
+}
+
+void String::toCharArray(char* buf, unsigned int size, unsigned int index) const {
+  if (!buf || size == 0) return;
+  if (index >= _str.length()) {
+    buf[0] = '\0';
+    return;
+  }
+  size_t n = std::min<size_t>(size - 1, _str.length() - index);
+  memcpy(buf, _str.data() + index, n);
+  buf[n] = '\0';
+}
+
+String operator+(const String& lhs, const String& rhs) {
+  String str(lhs);
+  return str += rhs;
+}
+
+String operator+(const String& lhs, const char* rhs) {
+  String str(lhs);
+  return str += rhs;
+}
+
+String operator+(const char* lhs, const String& rhs) {
+  String str(lhs);
+  return str += rhs;
+}
+
+String operator+(const String& lhs, char rhs) {
+  String str(lhs);
+  return str += rhs;
+}
+
+String operator+(const String& lhs, int rhs) { return lhs + String(rhs); }
+
+String operator+(const String& lhs, unsigned int rhs) { return lhs + String(rhs); }
+
+String operator+(const String& lhs, long rhs) { return lhs + String(rhs); }
+
+String operator+(const String& lhs, unsigned long rhs) { return lhs + String(rhs); }
+
+String operator+(const String& lhs, double rhs) { return lhs + String(rhs); }
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    if (!write(*buffer++)) break;
+    n++;
+  }
+  return n;
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) return 0;
+  if ((size_t)len < sizeof(buf)) return write((const uint8_t*)buf, len);
+
+  // Didn't fit on the stack, so format once more on the heap.
+  char* big = (char*)malloc(len + 1);
+  if (!big) return 0;
+  va_start(args, format);
+  vsnprintf(big, len + 1, format, args);
+  va_end(args);
+  size_t n = write((const uint8_t*)big, len);
+  free(big);
+  return n;
+}
+
+int Stream::timedRead(void) {
+  unsigned long start = millis();
+  do {
+    int c = read();
+    if (c >= 0) return c;
+    delay(1);
+  } while (millis() - start < _timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) break;
+    *buffer++ = (char)c;
+    count++;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  std::string str;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    str += (char)c;
+    c = timedRead();
+  }
+  return String(str);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
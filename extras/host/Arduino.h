@@ -0,0 +1,186 @@
+/**
+ * @file Arduino.h
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ * Thin stand-in for the Arduino core so that the SDK can be compiled as an ordinary Linux
+ * library. It only covers what the SDK, Arduino_JSON and arduinoWebSockets actually use.
+ *
+ */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <cstddef>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+using std::nullptr_t;
+
+#define bit(b) (1UL << (b))
+#define F(string_literal) (string_literal)
+
+// Timing:
+// Milliseconds since the program started.
+unsigned long millis(void);
+// Microseconds since the program started.
+unsigned long micros(void);
+// Sleeps for ms milliseconds.
+void delay(unsigned long ms);
+// Lets other threads run.
+void yield(void);
+
+// Random numbers:
+// Seeds the random number generator.
+void randomSeed(unsigned long seed);
+// Returns a random number in [0, max).
+long random(long max);
+// Returns a random number in [min, max).
+long random(long min, long max);
+
+// Arduino String modelled on top of std::string.
+class String {
+  private:
+    std::string _str;
+    // Tells whether the string was constructed from a null pointer.
+    bool _invalid;
+
+  public:
+    String(const char* str = "");
+    String(const char* str, size_t length);
+    String(const std::string& str);
+    explicit String(char c);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(double value, unsigned char decimalPlaces = 2);
+
+    const char* c_str() const { return _invalid ? NULL : _str.c_str(); }
+    unsigned int length() const { return _str.length(); }
+    bool reserve(unsigned int size);
+
+    String& operator+=(const String& rhs);
+    String& operator+=(const char* rhs);
+    String& operator+=(char rhs);
+    String& operator+=(int rhs);
+    String& operator+=(unsigned int rhs);
+    String& operator+=(long rhs);
+    String& operator+=(unsigned long rhs);
+    String& operator+=(double rhs);
+    bool concat(const char* str, unsigned int length);
+
+    bool operator==(const String& rhs) const { return _str == rhs._str; }
+    bool operator==(const char* rhs) const { return rhs && _str == rhs; }
+    bool operator!=(const String& rhs) const { return !(*this == rhs); }
+    bool operator!=(const char* rhs) const { return !(*this == rhs); }
+    bool operator<(const String& rhs) const { return _str < rhs._str; }
+    char operator[](unsigned int index) const;
+    char& operator[](unsigned int index);
+
+    bool equalsIgnoreCase(const String& rhs) const;
+    bool startsWith(const String& prefix) const;
+    bool endsWith(const String& suffix) const;
+    int indexOf(char c, unsigned int from = 0) const;
+    int indexOf(const String& str, unsigned int from = 0) const;
+    String substring(unsigned int from) const;
+    String substring(unsigned int from, unsigned int to) const;
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void trim(void);
+    void toLowerCase(void);
+    long toInt(void) const;
+    void toCharArray(char* buf, unsigned int size, unsigned int index = 0) const;
+};
+
+String operator+(const String& lhs, const String& rhs);
+String operator+(const String& lhs, const char* rhs);
+String operator+(const char* lhs, const String& rhs);
+String operator+(const String& lhs, char rhs);
+String operator+(const String& lhs, int rhs);
+String operator+(const String& lhs, unsigned int rhs);
+String operator+(const String& lhs, long rhs);
+String operator+(const String& lhs, unsigned long rhs);
+String operator+(const String& lhs, double rhs);
+
+class Print;
+
+// Interface for objects that know how to print themselves.
+class Printable {
+  public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+// Byte sink with the formatting helpers of the Arduino core.
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+    virtual void flush() {}
+
+    size_t print(const char* str) { return write(str); }
+    size_t print(const String& str) { return write((const uint8_t*)str.c_str(), str.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print(String(value)); }
+    size_t print(unsigned int value) { return print(String(value)); }
+    size_t print(long value) { return print(String(value)); }
+    size_t print(unsigned long value) { return print(String(value)); }
+    size_t print(double value) { return print(String(value)); }
+    size_t print(const Printable& p) { return p.printTo(*this); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+    size_t println(void) { return write("\r\n"); }
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// Readable byte stream with a timeout, like the Arduino core's Stream.
+class Stream : public Print {
+  protected:
+    unsigned long _timeout;
+    // Reads a byte waiting at most _timeout milliseconds. Returns -1 on timeout.
+    int timedRead(void);
+
+  public:
+    Stream() : _timeout(1000) {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    size_t readBytes(char* buffer, size_t length);
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    String readStringUntil(char terminator);
+};
+
+// Console port: writes to stdout.
+class HardwareSerial : public Stream {
+  public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override { fflush(stdout); }
+};
+
+extern HardwareSerial Serial;
+
+#endif /* HOST_ARDUINO_H_ */
@@ -0,0 +1,35 @@
+/**
+ * @file IPAddress.h
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ */
+
+#ifndef HOST_IPADDRESS_H_
+#define HOST_IPADDRESS_H_
+
+#include "Arduino.h"
+
+// IPv4 address, like the Arduino core's IPAddress.
+class IPAddress {
+  private:
+    uint8_t _address[4];
+
+  public:
+    IPAddress() : _address{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return _address[index]; }
+    uint8_t& operator[](int index) { return _address[index]; }
+
+    String toString() const {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+      return String(buf);
+    }
+};
+
+#endif /* HOST_IPADDRESS_H_ */
@@ -0,0 +1,470 @@
+/**
+ * @file PosixNetwork.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ */
+
+#include "PosixNetwork.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#ifdef POSIX_TLS
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+// Closes the socket once the last client copy is gone.
+static std::shared_ptr<int> shareSocket(int fd) {
+  return std::shared_ptr<int>(new int(fd), [](int* fd) {
+    if (*fd >= 0) ::close(*fd);
+    delete fd;
+  });
+}
+
+// Switches a socket to non-blocking mode so reads and writes never stall the loop.
+static void setNonBlocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+#ifdef POSIX_TLS
+// Records go through memory BIOs instead of the socket, so the socket is read and written here
+// just like a plain one, and SSL_write never has to be retried with the same arguments: what
+// the socket doesn't take waits in out.
+struct PosixTls {
+  SSL* ssl;
+  BIO* in;
+  BIO* out;
+
+  PosixTls(SSL_CTX* context) : ssl(SSL_new(context)), in(BIO_new(BIO_s_mem())), out(BIO_new(BIO_s_mem())) {
+    // Running out of input means waiting for more, not the end of the stream.
+    BIO_set_mem_eof_return(in, -1);
+    SSL_set_bio(ssl, in, out);
+  }
+  ~PosixTls() { SSL_free(ssl); }
+};
+
+// Moves what the socket has into the TLS input. Returns false once the peer has closed it.
+static bool tlsFill(int fd, PosixTls* tls) {
+  uint8_t buffer[16 * 1024];
+  ssize_t ret = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+  if (ret > 0) {
+    PosixClient::bytesRead += ret;
+    BIO_write(tls->in, buffer, ret);
+    return true;
+  }
+  return ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+// Sends as much of the TLS output as the socket takes.
+static void tlsFlush(int fd, PosixTls* tls) {
+  char* data;
+  long length = BIO_get_mem_data(tls->out, &data);
+  if (length <= 0) return;
+  ssize_t ret = send(fd, data, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (ret <= 0) return;
+  PosixClient::bytesWritten += ret;
+  // Dropping what went out from the BIO.
+  char sent[4096];
+  while (ret > 0) ret -= BIO_read(tls->out, sent, ret < (ssize_t)sizeof(sent) ? ret : sizeof(sent));
+}
+#endif
+
+unsigned long long PosixClient::bytesWritten = 0;
+unsigned long long PosixClient::bytesRead = 0;
+
+PosixClient::PosixClient() {}
+
+PosixClient::PosixClient(int fd) {
+  if (fd >= 0) {
+    setNonBlocking(fd);
+    _socket = shareSocket(fd);
+  }
+}
+
+int PosixClient::connect(const char* host, uint16_t port) {
+  return connect(host, port, POSIX_CONNECT_TIMEOUT);
+}
+
+int PosixClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  stop();
+
+  struct addrinfo hints;
+  struct addrinfo* result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  char service[8];
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &result) != 0) return 0;
+
+  int fd = -1;
+  for (struct addrinfo* ai = result; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0) continue;
+    setNonBlocking(fd);
+
+    // Connecting in non-blocking mode so that we can bound the wait by timeout.
+    int ret = ::connect(fd, ai->ai_addr, ai->ai_addrlen);
+    if (ret < 0 && errno == EINPROGRESS) {
+      struct pollfd pfd = {fd, POLLOUT, 0};
+      int err = 0;
+      socklen_t len = sizeof(err);
+      if (poll(&pfd, 1, timeout) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0)
+        ret = 0;
+    }
+    if (ret == 0) break;
+
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+
+  if (fd < 0) return 0;
+  _socket = shareSocket(fd);
+  return 1;
+}
+
+uint8_t PosixClient::connected() {
+  if (fd() < 0) return 0;
+#ifdef POSIX_TLS
+  // Records already taken from the socket may still hold data.
+  if (_tls && (SSL_pending(_tls->ssl) > 0 || BIO_ctrl_pending(_tls->in) > 0)) return 1;
+#endif
+  // Peeking tells us if the peer has closed its side.
+  char c;
+  ssize_t ret = recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+  if (ret > 0) return 1;
+  if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 1;
+  return 0;
+}
+
+void PosixClient::stop() {
+#ifdef POSIX_TLS
+  if (_tls && fd() >= 0 && SSL_is_init_finished(_tls->ssl)) {
+    // Telling the peer that the stream ends here, if the socket takes it.
+    SSL_shutdown(_tls->ssl);
+    tlsFlush(fd(), _tls.get());
+  }
+  _tls.reset();
+#endif
+  if (_socket && *_socket >= 0) {
+    ::close(*_socket);
+    *_socket = -1;
+  }
+  _socket.reset();
+}
+
+void PosixClient::setNoDelay(bool noDelay) {
+  int flag = noDelay ? 1 : 0;
+  if (fd() >= 0) setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+IPAddress PosixClient::remoteIP() {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  if (fd() < 0 || getpeername(fd(), (struct sockaddr*)&addr, &len) != 0 || addr.sin_family != AF_INET)
+    return IPAddress();
+  uint32_t ip = ntohl(addr.sin_addr.s_addr);
+  return IPAddress(ip >> 24, ip >> 16, ip >> 8, ip);
+}
+
+int PosixClient::available() {
+  int n = 0;
+  if (fd() < 0) return 0;
+#ifdef POSIX_TLS
+  if (_tls) {
+    // Only a decrypted record tells how much data there is. Peeking also moves the handshake
+    // of a server along.
+    uint8_t c;
+    tlsFill(fd(), _tls.get());
+    if (SSL_pending(_tls->ssl) == 0) SSL_peek(_tls->ssl, &c, 1);
+    tlsFlush(fd(), _tls.get());
+    return SSL_pending(_tls->ssl);
+  }
+#endif
+  if (ioctl(fd(), FIONREAD, &n) != 0) return 0;
+  return n;
+}
+
+int PosixClient::read() {
+  uint8_t c;
+  return read(&c, 1) == 1 ? c : -1;
+}
+
+int PosixClient::read(uint8_t* buffer, size_t size) {
+  if (fd() < 0) return -1;
+#ifdef POSIX_TLS
+  if (_tls) {
+    tlsFill(fd(), _tls.get());
+    int ret = SSL_read(_tls->ssl, buffer, (int)size);
+    tlsFlush(fd(), _tls.get());
+    return ret > 0 ? ret : -1;
+  }
+#endif
+  ssize_t ret = recv(fd(), buffer, size, MSG_DONTWAIT);
+  if (ret <= 0) return -1;
+  bytesRead += ret;
+  return (int)ret;
+}
+
+int PosixClient::peek() {
+  uint8_t c;
+  if (fd() < 0) return -1;
+#ifdef POSIX_TLS
+  if (_tls) {
+    tlsFill(fd(), _tls.get());
+    int ret = SSL_peek(_tls->ssl, &c, 1);
+    tlsFlush(fd(), _tls.get());
+    return ret == 1 ? c : -1;
+  }
+#endif
+  return recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1 ? c : -1;
+}
+
+size_t PosixClient::write(uint8_t c) {
+  return write(&c, 1);
+}
+
+size_t PosixClient::write(const uint8_t* buffer, size_t size) {
+  if (fd() < 0) return 0;
+#ifdef POSIX_TLS
+  if (_tls) {
+    tlsFlush(fd(), _tls.get());
+    // Taking nothing while the socket is behind, as a full send window would.
+    if (BIO_ctrl_pending(_tls->out) >= POSIX_TLS_BACKLOG) return 0;
+    int ret = SSL_write(_tls->ssl, buffer, (int)size);
+    tlsFlush(fd(), _tls.get());
+    return ret > 0 ? ret : 0;
+  }
+#endif
+  ssize_t ret = send(fd(), buffer, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+  // Returning 0 when the send window is full lets the caller retry, just like on the ESPs.
+  if (ret <= 0) return 0;
+  bytesWritten += ret;
+  return (size_t)ret;
+}
+
+size_t PosixClient::writev(const struct iovec* iov, int count) {
+  if (fd() < 0) return 0;
+#ifdef POSIX_TLS
+  if (_tls) {
+    // Gathering small buffers into one record, where a frame header would otherwise take a
+    // record of its own.
+    uint8_t record[1024];
+    size_t length = 0;
+    for (int i = 0; i < count; i++) length += iov[i].iov_len;
+    if (length <= sizeof(record)) {
+      length = 0;
+      for (int i = 0; i < count; i++) {
+        memcpy(record + length, iov[i].iov_base, iov[i].iov_len);
+        length += iov[i].iov_len;
+      }
+      return write(record, length);
+    }
+    size_t written = 0;
+    for (int i = 0; i < count; i++) {
+      size_t ret = write((const uint8_t*)iov[i].iov_base, iov[i].iov_len);
+      written += ret;
+      if (ret < iov[i].iov_len) break;
+    }
+    return written;
+  }
+#endif
+  // sendmsg rather than ::writev, which has no way to pass MSG_NOSIGNAL.
+  struct msghdr msg = {};
+  msg.msg_iov = const_cast<struct iovec*>(iov);
+  msg.msg_iovlen = count;
+  ssize_t ret = sendmsg(fd(), &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+  if (ret <= 0) return 0;
+  bytesWritten += ret;
+  return (size_t)ret;
+}
+
+#ifdef POSIX_TLS
+PosixSecureSession::~PosixSecureSession() {
+  SSL_SESSION_free(_session);
+}
+
+void PosixSecureSession::set(SSL_SESSION* session) {
+  SSL_SESSION_free(_session);
+  _session = session;
+}
+
+// Keeps the sessions the server issues in the PosixSecureSession of the connection. With
+// TLS 1.3 they come after the handshake and are read along with the data.
+static int keepSession(SSL* ssl, SSL_SESSION* session) {
+  PosixSecureSession* kept = (PosixSecureSession*)SSL_get_app_data(ssl);
+  if (!kept) return 0;
+  kept->set(session);
+  return 1;
+}
+
+unsigned long PosixSecureClient::handshakes = 0;
+unsigned long PosixSecureClient::resumptions = 0;
+
+PosixSecureClient::PosixSecureClient() : _context(SSL_CTX_new(TLS_client_method())), _session(NULL) {
+  SSL_CTX_set_default_verify_paths(_context);
+  SSL_CTX_set_verify(_context, SSL_VERIFY_PEER, NULL);
+  SSL_CTX_set_session_cache_mode(_context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(_context, keepSession);
+}
+
+PosixSecureClient::~PosixSecureClient() {
+  stop();
+  SSL_CTX_free(_context);
+}
+
+int PosixSecureClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  unsigned long start = millis();
+  if (!PosixClient::connect(host, port, timeout)) return 0;
+
+  PosixTls* tls = new PosixTls(_context);
+  _tls.reset(tls);
+  SSL_set_connect_state(tls->ssl);
+  SSL_set_tlsext_host_name(tls->ssl, host);
+  if (SSL_CTX_get_verify_mode(_context) != SSL_VERIFY_NONE) SSL_set1_host(tls->ssl, host);
+  SSL_set_app_data(tls->ssl, _session);
+  if (_session && _session->get()) SSL_set_session(tls->ssl, _session->get());
+
+  // Running the handshake over the non-blocking socket, bounded by what's left of timeout.
+  while (true) {
+    ERR_clear_error();
+    int ret = SSL_do_handshake(tls->ssl);
+    tlsFlush(fd(), tls);
+    if (ret == 1) break;
+    struct pollfd pfd = {fd(), POLLIN, 0};
+    long left = timeout - (long)(millis() - start);
+    if (SSL_get_error(tls->ssl, ret) != SSL_ERROR_WANT_READ || left <= 0 || poll(&pfd, 1, left) != 1 ||
+        !tlsFill(fd(), tls)) {
+      ERR_clear_error();
+      stop();
+      return 0;
+    }
+  }
+
+  handshakes++;
+  if (SSL_session_reused(tls->ssl)) resumptions++;
+  return 1;
+}
+
+void PosixSecureClient::setCACert(const char* rootCA) {
+  X509_STORE* store = X509_STORE_new();
+  BIO* bio = BIO_new_mem_buf(rootCA, -1);
+  X509* cert;
+  while ((cert = PEM_read_bio_X509(bio, NULL, NULL, NULL))) {
+    X509_STORE_add_cert(store, cert);
+    X509_free(cert);
+  }
+  BIO_free(bio);
+  // Reading past the last certificate leaves an error behind.
+  ERR_clear_error();
+  SSL_CTX_set_cert_store(_context, store);
+  SSL_CTX_set_verify(_context, SSL_VERIFY_PEER, NULL);
+}
+
+void PosixSecureClient::setInsecure() {
+  SSL_CTX_set_verify(_context, SSL_VERIFY_NONE, NULL);
+}
+
+bool PosixSecureClient::verify(const char* fingerprint, const char* domain) {
+  X509* cert = _tls ? SSL_get1_peer_certificate(_tls->ssl) : NULL;
+  if (!cert) return false;
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int length = 0;
+  bool match = X509_digest(cert, EVP_sha256(), digest, &length) == 1 &&
+               (!domain || !*domain || X509_check_host(cert, domain, 0, 0, NULL) == 1);
+  X509_free(cert);
+
+  static const char hex[] = "0123456789abcdef";
+  for (unsigned int i = 0; match && i < length * 2; i++) {
+    while (*fingerprint && !isxdigit((unsigned char)*fingerprint)) fingerprint++;
+    uint8_t nibble = i % 2 ? digest[i / 2] & 0x0f : digest[i / 2] >> 4;
+    match = *fingerprint && tolower((unsigned char)*fingerprint++) == hex[nibble];
+  }
+  while (*fingerprint && !isxdigit((unsigned char)*fingerprint)) fingerprint++;
+  return match && !*fingerprint;
+}
+
+SSL_CTX* PosixServer::_context = NULL;
+
+bool PosixServer::setCertificate(const char* file) {
+  SSL_CTX* context = SSL_CTX_new(TLS_server_method());
+  if (SSL_CTX_use_certificate_chain_file(context, file) != 1 ||
+      SSL_CTX_use_PrivateKey_file(context, file, SSL_FILETYPE_PEM) != 1) {
+    SSL_CTX_free(context);
+    return false;
+  }
+  SSL_CTX_free(_context);
+  _context = context;
+  return true;
+}
+#endif
+
+PosixServer::PosixServer(uint16_t port) : _port(port), _listener(-1), _pending(-1) {}
+
+PosixServer::~PosixServer() {
+  close();
+}
+
+void PosixServer::begin() {
+  close();
+  _listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (_listener < 0) return;
+
+  int flag = 1;
+  setsockopt(_listener, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(_port);
+
+  if (bind(_listener, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(_listener, 16) != 0) {
+    ::close(_listener);
+    _listener = -1;
+    return;
+  }
+  setNonBlocking(_listener);
+}
+
+void PosixServer::close() {
+  if (_pending >= 0) ::close(_pending);
+  if (_listener >= 0) ::close(_listener);
+  _pending = -1;
+  _listener = -1;
+}
+
+bool PosixServer::hasClient() {
+  if (_pending < 0 && _listener >= 0) _pending = accept(_listener, NULL, NULL);
+  return _pending >= 0;
+}
+
+PosixClient PosixServer::available() {
+  if (!hasClient()) return PosixClient();
+  int fd = _pending;
+  _pending = -1;
+  PosixClient client(fd);
+#ifdef POSIX_TLS
+  // The handshake runs as the client is read from.
+  if (_context) {
+    client._tls.reset(new PosixTls(_context));
+    SSL_set_accept_state(client._tls->ssl);
+  }
+#endif
+  return client;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file PosixNetwork.h
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ * TCP client and server over POSIX sockets with the same interface as the WiFiClient and
+ * WiFiServer classes of the ESP cores. Used as the NETWORK_POSIX backend of arduinoWebSockets.
+ * Built with POSIX_TLS, clients may run TLS over OpenSSL: PosixSecureClient stands in for
+ * WiFiClientSecure and PosixServer may serve TLS.
+ *
+ */
+
+#ifndef HOST_POSIXNETWORK_H_
+#define HOST_POSIXNETWORK_H_
+
+#include "Arduino.h"
+#include "IPAddress.h"
+#include <memory>
+#include <sys/uio.h>
+
+// How long connect() waits for the TCP handshake in milliseconds.
+#define POSIX_CONNECT_TIMEOUT (5000)
+// Bytes of TLS records waiting for the socket above which write() takes nothing more.
+#define POSIX_TLS_BACKLOG (64 * 1024)
+
+// TLS state of a connection, defined in PosixNetwork.cpp.
+struct PosixTls;
+
+class PosixClient : public Stream {
+  private:
+    // Socket is shared between copies and closed when the last copy lets go of it,
+    // the same way WiFiClient shares its ClientContext.
+    std::shared_ptr<int> _socket;
+
+  protected:
+    int fd() const { return _socket ? *_socket : -1; }
+    // Set while the connection runs TLS, shared like the socket.
+    std::shared_ptr<PosixTls> _tls;
+    friend class PosixServer;
+
+  public:
+    // Bytes moved through every client of this process, for measuring what goes on the wire.
+    static unsigned long long bytesWritten;
+    static unsigned long long bytesRead;
+
+    PosixClient();
+    // Wraps an already connected socket.
+    explicit PosixClient(int fd);
+    virtual ~PosixClient() {}
+
+    int connect(const char* host, uint16_t port);
+    virtual int connect(const char* host, uint16_t port, int32_t timeout);
+    uint8_t connected();
+    void stop();
+    void setNoDelay(bool noDelay);
+    IPAddress remoteIP();
+
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size);
+    int peek() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    // Writes the buffers in order with one system call, as writev(2) does, and returns how
+    // many bytes the socket took.
+    size_t writev(const struct iovec* iov, int count);
+    using Print::write;
+    void flush() override {}
+
+    operator bool() { return connected(); }
+};
+
+#ifdef POSIX_TLS
+typedef struct ssl_ctx_st SSL_CTX;
+typedef struct ssl_session_st SSL_SESSION;
+
+// TLS session to resume, like BearSSL::Session. Filled by the PosixSecureClient it is set on
+// when the server issues a session, and offered on the client's next connect.
+class PosixSecureSession {
+  private:
+    SSL_SESSION* _session;
+
+  public:
+    PosixSecureSession() : _session(NULL) {}
+    ~PosixSecureSession();
+    PosixSecureSession(const PosixSecureSession&) = delete;
+    PosixSecureSession& operator=(const PosixSecureSession&) = delete;
+
+    SSL_SESSION* get() const { return _session; }
+    // Takes ownership of the session.
+    void set(SSL_SESSION* session);
+};
+
+// TLS client with the interface of WiFiClientSecure on the ESP32.
+class PosixSecureClient : public PosixClient {
+  private:
+    SSL_CTX* _context;
+    PosixSecureSession* _session;
+
+  public:
+    // Handshakes done by every secure client of this process, and how many of them resumed a
+    // session.
+    static unsigned long handshakes;
+    static unsigned long resumptions;
+
+    PosixSecureClient();
+    ~PosixSecureClient();
+    PosixSecureClient(const PosixSecureClient&) = delete;
+    PosixSecureClient& operator=(const PosixSecureClient&) = delete;
+
+    using PosixClient::connect;
+    // Connects and runs the TLS handshake, both within timeout.
+    int connect(const char* host, uint16_t port, int32_t timeout) override;
+
+    // Trusts the PEM certificates only, instead of the system's.
+    void setCACert(const char* rootCA);
+    // Skips verifying the server's certificate.
+    void setInsecure();
+    // Resumes the session if it holds one and keeps the sessions the server issues in it.
+    void setSession(PosixSecureSession* session) { _session = session; }
+    // Checks the SHA-256 fingerprint of the server's certificate, as hex with or without
+    // separators, and the host name it was issued for unless domain is empty.
+    bool verify(const char* fingerprint, const char* domain);
+};
+#endif
+
+class PosixServer {
+  private:
+    uint16_t _port;
+    int _listener;
+    // Accepted socket waiting to be picked up by available().
+    int _pending;
+#ifdef POSIX_TLS
+    static SSL_CTX* _context;
+#endif
+
+  public:
+    PosixServer(uint16_t port);
+    ~PosixServer();
+
+#ifdef POSIX_TLS
+    // Serves TLS on the clients of every server with the certificate chain and private key
+    // in the PEM file. Returns false if they can't be loaded.
+    static bool setCertificate(const char* file);
+#endif
+
+    void begin();
+    void close();
+    void end() { close(); }
+    bool hasClient();
+    PosixClient available();
+};
+
+#endif /* HOST_POSIXNETWORK_H_ */
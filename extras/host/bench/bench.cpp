@@ -0,0 +1,288 @@
+/**
+ * @file bench.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ * End-to-end benchmark of the duplex request/response path. Starts the stand-in server in a
+ * child process, drives the SDK against it and reports per scenario:
+ *   msgs/s      completed requests per second
+ *   p50, p99    round trip time from the SDK call to its callback in microseconds
+ *   tx, rx      bytes on the wire per request, websocket framing included
+ *   allocs      heap allocations of the SDK per request
+ *
+ *   grandeur-bench [-n requests] [-w window] [-l latency] [-b batchWindow] [-s scenario]
+ *                  [-t certificate]
+ *
+ */
+
+#include "../server/GrandeurServer.h"
+#include <Grandeur.h>
+#include <PosixNetwork.h>
+#include <algorithm>
+#include <deque>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <vector>
+
+// Counting every heap allocation of this process by interposing the glibc allocator.
+// operator new ends up here as well. Sanitizers bring their own allocator, so there's nothing
+// to count under them.
+static unsigned long long allocations = 0;
+
+#ifndef __SANITIZE_ADDRESS__
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+  allocations++;
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+  allocations++;
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  allocations++;
+  return __libc_realloc(ptr, size);
+}
+}
+#endif
+
+// How long a scenario may go without a single response before it's given up.
+#define BENCH_STALL_TIMEOUT (5000)
+// Requests sent before measuring, to get connection buffers and caches warm.
+#define BENCH_WARMUP (100)
+
+struct Scenario {
+  const char* name;
+  // Issues one request whose callback is onResponse.
+  void (*issue)(void);
+};
+
+static Grandeur::Project project;
+static Grandeur::Project::Device::Data data;
+// Collection can't be default constructed.
+static Grandeur::Project::Datastore::Collection* collection;
+static unsigned long counter = 0;
+
+// Send times of the requests in flight. The stand-in server answers in order, so the oldest
+// request is the one a response belongs to.
+static std::deque<unsigned long> inFlight;
+static std::vector<unsigned long> rtts;
+static unsigned long completed = 0;
+
+static void onResponse(const char* code, Var result) {
+  if (inFlight.empty()) return;
+  rtts.push_back(micros() - inFlight.front());
+  inFlight.pop_front();
+  completed++;
+}
+
+static void setData(void) {
+  data.set("voltage", (int)counter++, onResponse);
+}
+
+static void getData(void) {
+  data.get("voltage", onResponse);
+}
+
+static void insertDocuments(void) {
+  // A batch of readings, like a device logging every few seconds would send.
+  Var documents;
+  for (int i = 0; i < 10; i++) {
+    documents[i]["voltage"] = (int)(counter % 300);
+    documents[i]["current"] = (double)(counter % 100) / 10;
+    documents[i]["millis"] = millis();
+    counter++;
+  }
+  collection->insert(documents, onResponse);
+}
+
+static void searchDocuments(void) {
+  collection->search(undefined, undefined, 1, onResponse);
+}
+
+static const Scenario scenarios[] = {
+  {"data.set", setData},
+  {"data.get", getData},
+  {"datastore.insert", insertDocuments},
+  {"datastore.search", searchDocuments},
+};
+
+static unsigned long percentile(std::vector<unsigned long>& values, double p) {
+  if (values.empty()) return 0;
+  size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + i, values.end());
+  return values[i];
+}
+
+// Sends n requests keeping up to window of them in flight. Returns false on a stall.
+static bool drive(const Scenario& scenario, unsigned long n, unsigned long window) {
+  unsigned long issued = 0;
+  unsigned long lastProgress = millis();
+  unsigned long lastCompleted = completed;
+  unsigned long target = completed + n;
+
+  while (completed < target) {
+    while (issued < n && inFlight.size() < window) {
+      inFlight.push_back(micros());
+      scenario.issue();
+      issued++;
+    }
+    project.loop();
+
+    if (completed != lastCompleted) {
+      lastCompleted = completed;
+      lastProgress = millis();
+    } else if (millis() - lastProgress > BENCH_STALL_TIMEOUT) {
+      inFlight.clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+static void run(const Scenario& scenario, unsigned long n, unsigned long window) {
+  if (!drive(scenario, BENCH_WARMUP, window)) {
+    printf("%-18s stalled during warmup\n", scenario.name);
+    return;
+  }
+
+  rtts.clear();
+  rtts.reserve(n);
+  unsigned long long tx = PosixClient::bytesWritten;
+  unsigned long long rx = PosixClient::bytesRead;
+  unsigned long long allocs = allocations;
+  unsigned long start = micros();
+
+  bool finished = drive(scenario, n, window);
+
+  unsigned long elapsed = micros() - start;
+  allocs = allocations - allocs;
+  tx = PosixClient::bytesWritten - tx;
+  rx = PosixClient::bytesRead - rx;
+  unsigned long done = rtts.size();
+  if (!finished || done == 0) {
+    printf("%-18s stalled after %lu of %lu requests\n", scenario.name, done, n);
+    return;
+  }
+  // Every payload and response is freed by now. Anything left pins the arena, which sends the
+  // allocations counted below to the heap.
+  if (project.arenaUsed() != 0)
+    printf("%-18s JSON arena still holds %zu bytes\n", scenario.name, project.arenaUsed());
+
+  printf("%-18s %8lu %10.0f %8lu %8lu %8.1f %8.1f %8.1f\n", scenario.name, done, done * 1e6 / elapsed,
+         percentile(rtts, 0.50), percentile(rtts, 0.99), (double)tx / done, (double)rx / done,
+         (double)allocs / done);
+  fflush(stdout);
+}
+
+// Runs the stand-in server until the parent goes away.
+static pid_t startServer(unsigned long latency) {
+  pid_t pid = fork();
+  if (pid != 0) return pid;
+
+  prctl(PR_SET_PDEATHSIG, SIGTERM);
+  GrandeurServer::Options options;
+  options.port = GRANDEUR_PORT;
+  options.latency = latency;
+  GrandeurServer server(options);
+  server.begin();
+  // Spinning without sleeps, so the server is never what's being measured.
+  while (true) server.loop();
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -n, --requests N         measured requests per scenario (10000)\n"
+          "  -w, --window N           requests kept in flight (1)\n"
+          "  -l, --latency MS         delay the server adds to every response (0)\n"
+          "  -b, --batch MS           batch messages sent within MS, 0 for within a loop (off)\n"
+          "  -s, --scenario NAME      run only the scenario, e.g. data.set\n"
+          "  -t, --tls PEM            serve TLS with the certificate and key in PEM (TLS=1 builds)\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  unsigned long n = 10000;
+  unsigned long window = 1;
+  unsigned long latency = 0;
+  const char* only = NULL;
+  long batchWindow = -1;
+
+  static const struct option longOptions[] = {
+    {"requests", required_argument, NULL, 'n'},
+    {"window", required_argument, NULL, 'w'},
+    {"latency", required_argument, NULL, 'l'},
+    {"batch", required_argument, NULL, 'b'},
+    {"scenario", required_argument, NULL, 's'},
+    {"tls", required_argument, NULL, 't'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "n:w:l:b:s:t:h", longOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'n': n = strtoul(optarg, NULL, 10); break;
+    case 'w': window = std::max(1UL, strtoul(optarg, NULL, 10)); break;
+    case 'l': latency = strtoul(optarg, NULL, 10); break;
+    case 'b': batchWindow = strtol(optarg, NULL, 10); break;
+    case 's': only = optarg; break;
+#ifdef POSIX_TLS
+    // Set before forking, so the server picks it up.
+    case 't':
+      if (!PosixServer::setCertificate(optarg)) {
+        fprintf(stderr, "Couldn't load the certificate and key from %s.\n", optarg);
+        return 1;
+      }
+      break;
+#endif
+    default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  pid_t server = startServer(latency);
+
+  project = grandeur.init("bench-api-key", "bench-token");
+  data = project.device("bench-device").data();
+  collection = new Grandeur::Project::Datastore::Collection(project.datastore().collection("bench-logs"));
+  if (batchWindow >= 0) project.enableBatching(batchWindow);
+
+  // The server may not be listening yet when the first attempts are made.
+  unsigned long start = millis();
+  while (!project.isConnected() && millis() - start < 15000) {
+    project.loop();
+    delay(1);
+  }
+  if (!project.isConnected()) {
+    fprintf(stderr, "Couldn't connect to the stand-in server on %s:%d.\n", GRANDEUR_URL, GRANDEUR_PORT);
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    return 1;
+  }
+
+  printf("%lu requests per scenario, window %lu, server latency %lu ms", n, window, latency);
+  if (batchWindow >= 0) printf(", batching within %ld ms", batchWindow);
+  printf("\n\n");
+  printf("%-18s %8s %10s %8s %8s %8s %8s %8s\n", "scenario", "msgs", "msgs/s", "p50 us", "p99 us", "tx B", "rx B",
+         "allocs");
+  for (const Scenario& scenario : scenarios) {
+    if (only && strcmp(only, scenario.name) != 0) continue;
+    run(scenario, n, window);
+  }
+
+  kill(server, SIGTERM);
+  waitpid(server, NULL, 0);
+  return 0;
+}
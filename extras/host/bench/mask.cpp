@@ -0,0 +1,89 @@
+/**
+ * @file mask.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ * Microbenchmark of websocket payload masking. Checks WebSockets::mask() against the byte by
+ * byte loop it replaced for every alignment and tail length, then reports per payload size:
+ *   bytewise    MB/s of the byte by byte loop
+ *   mask        MB/s of WebSockets::mask()
+ *
+ *   grandeur-mask-bench [-t milliseconds]
+ *
+ */
+
+#include <arduinoWebSockets/WebSockets.h>
+#include <getopt.h>
+#include <vector>
+
+static const uint8_t maskKey[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+// What sendFrame and handleWebsocketPayloadCb did before.
+static void __attribute__((noinline)) maskBytewise(uint8_t* data, size_t length, const uint8_t key[4]) {
+  for (size_t x = 0; x < length; x++) data[x] = (data[x] ^ key[x % 4]);
+}
+
+static bool check(void) {
+  std::vector<uint8_t> expected(300), actual(300);
+  for (size_t offset = 0; offset < 32; offset++) {
+    for (size_t length = 0; length + offset <= actual.size(); length++) {
+      for (size_t i = 0; i < actual.size(); i++) expected[i] = actual[i] = (uint8_t)(i * 131 + length);
+      maskBytewise(expected.data() + offset, length, maskKey);
+      WebSockets::mask(actual.data() + offset, length, maskKey);
+      if (expected != actual) {
+        fprintf(stderr, "Mismatch at offset %zu, length %zu.\n", offset, length);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Masks the buffer over and over for about duration milliseconds and returns MB/s.
+static double measure(void (*kernel)(uint8_t*, size_t, const uint8_t*), std::vector<uint8_t>& buffer,
+                      size_t offset, size_t size, unsigned long duration) {
+  unsigned long long bytes = 0;
+  unsigned long start = micros();
+  unsigned long elapsed;
+  do {
+    for (int i = 0; i < 64; i++) kernel(buffer.data() + offset, size, maskKey);
+    bytes += 64ULL * size;
+    elapsed = micros() - start;
+  } while (elapsed < duration * 1000);
+  // Keeping the compiler from dropping the work.
+  volatile uint8_t sink = buffer[offset];
+  (void)sink;
+  return (double)bytes / elapsed;
+}
+
+int main(int argc, char** argv) {
+  unsigned long duration = 200;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:h")) != -1) {
+    switch (opt) {
+    case 't': duration = strtoul(optarg, NULL, 10); break;
+    default:
+      fprintf(stderr, "Usage: %s [-t milliseconds per measurement (200)]\n", argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  if (!check()) return 1;
+
+  static const size_t sizes[] = {16, 64, 128, 512, 1024, 4096, 16384};
+  std::vector<uint8_t> buffer(16384 + 64, 0x5a);
+
+  printf("%8s %8s %12s %12s %8s\n", "bytes", "offset", "bytewise", "mask", "speedup");
+  for (size_t size : sizes) {
+    // Payloads start 14 bytes into the send buffer, so unaligned is the common case.
+    for (size_t offset : {0, 14}) {
+      double bytewise = measure(maskBytewise, buffer, offset, size, duration);
+      double masked = measure(WebSockets::mask, buffer, offset, size, duration);
+      printf("%8zu %8zu %12.0f %12.0f %7.1fx\n", size, offset, bytewise, masked, masked / bytewise);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,372 @@
+/**
+ * @file GrandeurServer.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ */
+
+#include "GrandeurServer.h"
+#include <algorithm>
+
+// Returns true if doc has every key of filter with an equal value.
+static bool matches(Var& doc, Var& filter) {
+  if (!filter.isObject()) return true;
+  Var keys = filter.keys();
+  for (int i = 0; i < keys.length(); i++) {
+    const char* key = keys[i];
+    if (!doc.hasOwnProperty(key)) return false;
+    Var a = doc[key];
+    Var b = filter[key];
+    if (!(a == b)) return false;
+  }
+  return true;
+}
+
+// Returns the number of elements of an array and 0 for anything else.
+static int count(Var& array) {
+  return array.isArray() ? array.length() : 0;
+}
+
+// Appends a copy of item to the array.
+static void append(Var& array, Var& item) {
+  array[count(array)] = item;
+}
+
+GrandeurServer::GrandeurServer(Options options)
+    : _options(options), _server(options.port, "", "node"), _random(std::random_device()()) {}
+
+void GrandeurServer::begin(void) {
+  _server.onEvent([=](uint8_t client, WStype_t type, uint8_t* payload, size_t length) {
+    handleEvent(client, type, payload, length);
+  });
+  _server.begin();
+}
+
+void GrandeurServer::loop(void) {
+  _server.loop();
+
+  // Sending every message that is due.
+  unsigned long now = millis();
+  while (!_outbox.empty() && _outbox.begin()->first <= now) {
+    Outgoing& out = _outbox.begin()->second;
+    if (_options.verbose) printf("[%u] <- %s\n", out.client, out.message.c_str());
+    if (send(out.client, out.message)) {
+      _stats.messagesOut++;
+      _stats.bytesOut += out.message.length();
+    }
+    _outbox.erase(_outbox.begin());
+  }
+}
+
+bool GrandeurServer::send(uint8_t client, String& message) {
+  size_t length = message.length();
+  size_t size = _options.fragmentSize;
+  if (size == 0 || length <= size) return _server.sendTXT(client, message);
+
+  uint8_t* text = (uint8_t*)message.c_str();
+  for (size_t sent = 0; sent < length; sent += size) {
+    size_t n = std::min(size, length - sent);
+    WSopcode_t opcode = sent == 0 ? WSop_text : WSop_continuation;
+    if (!_server.sendFragment(client, opcode, text + sent, n, sent + n == length)) return false;
+  }
+  return true;
+}
+
+void GrandeurServer::handleEvent(uint8_t client, WStype_t type, uint8_t* payload, size_t length) {
+  switch (type) {
+  case WStype_CONNECTED:
+    _stats.connections++;
+    break;
+
+  case WStype_DISCONNECTED:
+    // Subscriptions and pending messages die with the connection.
+    for (auto it = _subscriptions.begin(); it != _subscriptions.end();) {
+      if (it->client == client) it = _subscriptions.erase(it);
+      else it++;
+    }
+    for (auto it = _outbox.begin(); it != _outbox.end();) {
+      if (it->second.client == client) it = _outbox.erase(it);
+      else it++;
+    }
+    _fragments.erase(client);
+    break;
+
+  case WStype_TEXT:
+    handleText(client, (char*)payload, length);
+    break;
+
+  // Large messages come in fragments, which are put back together before being handled.
+  case WStype_FRAGMENT_TEXT_START:
+    _fragments[client] = String((char*)payload, length);
+    break;
+
+  case WStype_FRAGMENT:
+  case WStype_FRAGMENT_FIN: {
+    auto it = _fragments.find(client);
+    if (it == _fragments.end()) break;
+    it->second.concat((char*)payload, length);
+    if (type == WStype_FRAGMENT) break;
+
+    String text = std::move(it->second);
+    _fragments.erase(it);
+    handleText(client, text.c_str(), text.length());
+  } break;
+
+  default:
+    break;
+  }
+}
+
+void GrandeurServer::handleText(uint8_t client, const char* text, size_t length) {
+  _stats.bytesIn += length;
+  if (_options.verbose) printf("[%u] -> %s\n", client, text);
+
+  // Simulating a broken link.
+  if (chance(_options.disconnectRate)) {
+    _stats.disconnects++;
+    _server.disconnect(client);
+    return;
+  }
+
+  Var oMessage = JSON.parse(text);
+  if (oMessage.isObject()) {
+    _stats.messagesIn++;
+    Var header = oMessage["header"];
+    Var body = oMessage["payload"];
+    handleMessage(client, header, body);
+  } else if (oMessage.isArray()) {
+    // A batch of messages in one frame, handled in order.
+    for (int i = 0; i < oMessage.length(); i++) {
+      _stats.messagesIn++;
+      Var header = oMessage[i]["header"];
+      Var body = oMessage[i]["payload"];
+      handleMessage(client, header, body);
+    }
+  }
+}
+
+void GrandeurServer::handleMessage(uint8_t client, Var& header, Var& payload) {
+  const char* task = header["task"];
+  if (!task) return;
+
+  Var response;
+
+  if (strcmp(task, "ping") == 0) {
+    // Ping is answered with the bare header.
+    Var oMessage;
+    oMessage["header"] = header;
+    queue(client, JSON.stringify(oMessage));
+    return;
+  } else if (strcmp(task, "/topic/subscribe") == 0) {
+    const char* deviceID = payload["deviceID"];
+    const char* event = payload["event"];
+    const char* path = payload["path"];
+    _subscriptions.push_back({client, deviceID, event, path ? path : ""});
+    response["code"] = "TOPIC-SUBSCRIBED";
+  } else if (strcmp(task, "/topic/unsubscribe") == 0) {
+    const char* path = payload["path"];
+    String deviceID = (const char*)payload["deviceID"];
+    String event = (const char*)payload["event"];
+    for (auto it = _subscriptions.begin(); it != _subscriptions.end(); it++) {
+      if (it->client == client && it->deviceID == deviceID && it->event == event && it->path == (path ? path : "")) {
+        _subscriptions.erase(it);
+        break;
+      }
+    }
+    response["code"] = "TOPIC-UNSUBSCRIBED";
+  } else if (strcmp(task, "/device/data/get") == 0) {
+    getData(payload, response);
+  } else if (strcmp(task, "/device/data/set") == 0) {
+    setData(payload, response);
+  } else if (strcmp(task, "/datastore/insert") == 0) {
+    insertDocuments(payload, response);
+  } else if (strcmp(task, "/datastore/delete") == 0) {
+    deleteDocuments(payload, response);
+  } else if (strcmp(task, "/datastore/update") == 0) {
+    updateDocuments(payload, response);
+  } else if (strcmp(task, "/datastore/pipeline") == 0) {
+    runPipeline(payload, response);
+  } else {
+    response["code"] = "TASK-INVALID";
+  }
+
+  reply(client, header, response);
+}
+
+void GrandeurServer::reply(uint8_t client, Var& header, Var& payload) {
+  Var oMessage;
+  oMessage["header"] = header;
+  oMessage["payload"] = payload;
+  queue(client, JSON.stringify(oMessage));
+}
+
+void GrandeurServer::publish(const char* deviceID, const char* path, Var& update) {
+  Var oMessage;
+  oMessage["header"]["id"] = micros();
+  oMessage["header"]["task"] = "update";
+  oMessage["payload"]["event"] = "data";
+  oMessage["payload"]["deviceID"] = deviceID;
+  oMessage["payload"]["path"] = path;
+  oMessage["payload"]["update"] = update;
+  String message = JSON.stringify(oMessage);
+
+  String changed = path;
+  for (Subscription& s : _subscriptions) {
+    if (s.deviceID != deviceID || s.event != "data") continue;
+    // A listener on "a" hears updates of "a" and of "a.b", a listener on "" hears everything.
+    if (s.path.length() == 0 || changed == s.path || changed.startsWith(s.path + ".")) queue(s.client, message);
+  }
+}
+
+void GrandeurServer::queue(uint8_t client, const String& message) {
+  if (chance(_options.dropRate)) {
+    _stats.dropped++;
+    return;
+  }
+
+  long delay = _options.latency;
+  if (_options.jitter) {
+    std::uniform_int_distribution<long> jitter(-(long)_options.jitter, _options.jitter);
+    delay = std::max(0L, delay + jitter(_random));
+  }
+  _outbox.insert({millis() + delay, {client, message}});
+}
+
+void GrandeurServer::getData(Var& payload, Var& response) {
+  const char* path = payload["path"];
+  Var node = _devices[(const char*)payload["deviceID"]];
+
+  // Walking down the dot separated path without creating anything on the way.
+  String rest = path ? path : "";
+  while (rest.length() > 0) {
+    int dot = rest.indexOf('.');
+    String key = dot < 0 ? rest : rest.substring(0, dot);
+    rest = dot < 0 ? String("") : rest.substring(dot + 1);
+    if (!node.hasOwnProperty(key)) {
+      response["code"] = "DEVICE-DATA-FETCHED";
+      return;
+    }
+    node = node[key];
+  }
+
+  response["code"] = "DEVICE-DATA-FETCHED";
+  response["data"] = node;
+}
+
+void GrandeurServer::setData(Var& payload, Var& response) {
+  const char* deviceID = payload["deviceID"];
+  const char* path = payload["path"];
+  Var data = payload["data"];
+  Var node = _devices[deviceID];
+
+  // Walking down the dot separated path creating objects on the way.
+  String rest = path ? path : "";
+  while (rest.length() > 0) {
+    int dot = rest.indexOf('.');
+    String key = dot < 0 ? rest : rest.substring(0, dot);
+    rest = dot < 0 ? String("") : rest.substring(dot + 1);
+    node = node[key];
+  }
+  node = data;
+
+  response["code"] = "DEVICE-DATA-UPDATED";
+  response["path"] = path ? path : "";
+  response["update"] = data;
+
+  publish(deviceID, path ? path : "", data);
+}
+
+void GrandeurServer::insertDocuments(Var& payload, Var& response) {
+  Var documents = payload["documents"];
+  std::deque<Var>& collection = _collections[(const char*)payload["collection"]];
+
+  if (documents.isArray()) {
+    for (int i = 0; i < documents.length(); i++) {
+      // Taking a copy, documents[i] is only a view into the payload.
+      const Var& doc = documents[i];
+      collection.push_back(doc);
+    }
+  } else if (documents.isObject()) {
+    collection.push_back(documents);
+  }
+
+  response["code"] = "DATASTORE-DOCUMENTS-INSERTED";
+  response["message"] = "Documents are inserted.";
+}
+
+void GrandeurServer::deleteDocuments(Var& payload, Var& response) {
+  Var filter = payload["filter"];
+  std::deque<Var>& collection = _collections[(const char*)payload["collection"]];
+
+  int nDeleted = 0;
+  for (auto it = collection.begin(); it != collection.end();) {
+    if (matches(*it, filter)) {
+      it = collection.erase(it);
+      nDeleted++;
+    } else {
+      it++;
+    }
+  }
+
+  response["code"] = "DATASTORE-DOCUMENTS-DELETED";
+  response["message"] = "Documents are deleted.";
+  response["nDeleted"] = nDeleted;
+}
+
+void GrandeurServer::updateDocuments(Var& payload, Var& response) {
+  Var filter = payload["filter"];
+  Var update = payload["update"];
+  std::deque<Var>& collection = _collections[(const char*)payload["collection"]];
+  Var keys = update.isObject() ? update.keys() : Var();
+
+  int nUpdated = 0;
+  for (Var& doc : collection) {
+    if (!matches(doc, filter)) continue;
+    for (int k = 0; k < count(keys); k++) {
+      const char* key = keys[k];
+      Var value = update[key];
+      doc[key] = value;
+    }
+    nUpdated++;
+  }
+
+  response["code"] = "DATASTORE-DOCUMENTS-UPDATED";
+  response["message"] = "Documents are updated.";
+  response["nUpdated"] = nUpdated;
+}
+
+void GrandeurServer::runPipeline(Var& payload, Var& response) {
+  Var pipeline = payload["pipeline"];
+  std::deque<Var>& collection = _collections[(const char*)payload["collection"]];
+  int nPage = payload["nPage"];
+
+  // Only filters of the match stages are applied, everything else passes documents through.
+  std::vector<Var> filters;
+  for (int s = 0; s < count(pipeline); s++) {
+    Var stage = pipeline[s];
+    if (stage.isObject() && stage.hasOwnProperty("filter")) filters.push_back(stage["filter"]);
+  }
+
+  Var result = JSON.parse("[]");
+  int nDocuments = 0;
+  int first = (nPage > 1 ? nPage - 1 : 0) * _options.pageSize;
+  for (Var& doc : collection) {
+    bool matched = true;
+    for (size_t f = 0; f < filters.size() && matched; f++) matched = matches(doc, filters[f]);
+    if (!matched) continue;
+    if (nDocuments >= first && nDocuments < first + _options.pageSize) append(result, doc);
+    nDocuments++;
+  }
+
+  response["code"] = "DATASTORE-DOCUMENTS-FETCHED";
+  response["documents"] = result;
+  response["nDocuments"] = nDocuments;
+}
+
+bool GrandeurServer::chance(double probability) {
+  if (probability <= 0) return false;
+  return std::uniform_real_distribution<double>(0, 1)(_random) < probability;
+}
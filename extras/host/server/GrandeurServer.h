@@ -0,0 +1,120 @@
+/**
+ * @file GrandeurServer.h
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ * Local stand-in for api.grandeur.tech. It speaks the duplex protocol DuplexHandler expects
+ * and keeps device data and datastore collections in memory, so that request latency,
+ * reconnects and buffer flushes can be measured without the real backend. A frame may carry
+ * a single {header, payload} message or an array of them when the SDK batches.
+ *
+ */
+
+#ifndef GRANDEURSERVER_H_
+#define GRANDEURSERVER_H_
+
+#include <Var.h>
+#include <arduinoWebSockets/WebSocketsServer.h>
+#include <deque>
+#include <map>
+#include <random>
+#include <vector>
+
+class GrandeurServer {
+  public:
+    struct Options {
+      uint16_t port = 3000;
+      // Every outgoing message is held back for latency +/- jitter milliseconds.
+      unsigned long latency = 0;
+      unsigned long jitter = 0;
+      // Probability of silently dropping a response or update.
+      double dropRate = 0;
+      // Probability of closing the connection on a received message.
+      double disconnectRate = 0;
+      // Messages longer than this are sent in fragments of it. 0 sends every message in a frame.
+      size_t fragmentSize = 0;
+      // Number of documents per page of a datastore pipeline.
+      int pageSize = 20;
+      // Prints every message received and sent.
+      bool verbose = false;
+    };
+
+    struct Stats {
+      unsigned long connections = 0;
+      unsigned long messagesIn = 0;
+      unsigned long messagesOut = 0;
+      unsigned long bytesIn = 0;
+      unsigned long bytesOut = 0;
+      unsigned long dropped = 0;
+      unsigned long disconnects = 0;
+    };
+
+    GrandeurServer(Options options);
+
+    void begin(void);
+    // Runs the websocket server and sends the messages that are due.
+    void loop(void);
+
+    const Stats& stats(void) const { return _stats; }
+    void resetStats(void) { _stats = Stats(); }
+
+  private:
+    // Subscription of a connected client to updates of a device variable.
+    struct Subscription {
+      uint8_t client;
+      String deviceID;
+      String event;
+      String path;
+    };
+    // Message held back until its due time.
+    struct Outgoing {
+      uint8_t client;
+      String message;
+    };
+
+    Options _options;
+    Stats _stats;
+    WebSocketsServer _server;
+    std::mt19937 _random;
+
+    // Device data by device ID.
+    Var _devices;
+    // Documents by collection name. Indexing into a JSON array walks it from the start, which
+    // made inserts and searches quadratic in a growing collection.
+    std::map<String, std::deque<Var>> _collections;
+    std::vector<Subscription> _subscriptions;
+    // Outgoing messages ordered by the millis() they are due at.
+    std::multimap<unsigned long, Outgoing> _outbox;
+    // Text of fragmented messages being received, by client.
+    std::map<uint8_t, String> _fragments;
+
+    void handleEvent(uint8_t client, WStype_t type, uint8_t* payload, size_t length);
+    // Handles a whole text message, whether it came in one frame or in fragments.
+    void handleText(uint8_t client, const char* text, size_t length);
+    // Handles one {header, payload} envelope.
+    void handleMessage(uint8_t client, Var& header, Var& payload);
+    // Queues a response to a request with the header.
+    void reply(uint8_t client, Var& header, Var& payload);
+    // Queues an update for every subscription matching the device variable at path.
+    void publish(const char* deviceID, const char* path, Var& update);
+    // Queues a message to a client after the configured latency, unless it's dropped.
+    void queue(uint8_t client, const String& message);
+    // Sends a message in one frame, or in fragments of fragmentSize.
+    bool send(uint8_t client, String& message);
+
+    // Device data handlers.
+    void getData(Var& payload, Var& response);
+    void setData(Var& payload, Var& response);
+    // Datastore handlers.
+    void insertDocuments(Var& payload, Var& response);
+    void deleteDocuments(Var& payload, Var& response);
+    void updateDocuments(Var& payload, Var& response);
+    void runPipeline(Var& payload, Var& response);
+
+    bool chance(double probability);
+};
+
+#endif /* GRANDEURSERVER_H_ */
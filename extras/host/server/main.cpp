@@ -0,0 +1,111 @@
+/**
+ * @file main.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ * Runs the local stand-in server:
+ *   grandeur-server [-p port] [-l latency] [-j jitter] [-d dropRate] [-x disconnectRate]
+ *                   [-s statsInterval] [-t certificate] [-v]
+ *
+ */
+
+#include "GrandeurServer.h"
+#include <getopt.h>
+#include <signal.h>
+
+static volatile bool running = true;
+
+// Serves TLS with the certificate chain and key in the PEM file.
+static bool serveTls(const char* certificate) {
+#ifdef POSIX_TLS
+  if (PosixServer::setCertificate(certificate)) return true;
+  fprintf(stderr, "Couldn't load the certificate and key from %s.\n", certificate);
+#else
+  fprintf(stderr, "Serving TLS needs a build with TLS=1.\n");
+#endif
+  return false;
+}
+
+static void printStats(const GrandeurServer::Stats& stats) {
+  printf("connections: %lu, in: %lu msgs / %lu B, out: %lu msgs / %lu B, dropped: %lu, disconnects: %lu\n",
+         stats.connections, stats.messagesIn, stats.bytesIn, stats.messagesOut, stats.bytesOut, stats.dropped,
+         stats.disconnects);
+  fflush(stdout);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -p, --port PORT          port to listen on (3000)\n"
+          "  -l, --latency MS         delay of every outgoing message (0)\n"
+          "  -j, --jitter MS          random +/- variation of the delay (0)\n"
+          "  -d, --drop RATE          probability of dropping an outgoing message (0)\n"
+          "  -x, --disconnect RATE    probability of closing the connection per message (0)\n"
+          "  -f, --fragment BYTES     send longer messages in fragments of BYTES, 0 to disable (0)\n"
+          "  -s, --stats SECONDS      print counters every SECONDS, 0 to disable (0)\n"
+          "  -t, --tls PEM            serve TLS with the certificate and key in PEM\n"
+          "  -v, --verbose            print every message\n",
+          name);
+}
+
+int main(int argc, char** argv) {
+  GrandeurServer::Options options;
+  unsigned long statsInterval = 0;
+
+  static const struct option longOptions[] = {
+    {"port", required_argument, NULL, 'p'},
+    {"latency", required_argument, NULL, 'l'},
+    {"jitter", required_argument, NULL, 'j'},
+    {"drop", required_argument, NULL, 'd'},
+    {"disconnect", required_argument, NULL, 'x'},
+    {"fragment", required_argument, NULL, 'f'},
+    {"stats", required_argument, NULL, 's'},
+    {"tls", required_argument, NULL, 't'},
+    {"verbose", no_argument, NULL, 'v'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+  };
+
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:l:j:d:x:f:s:t:vh", longOptions, NULL)) != -1) {
+    switch (opt) {
+    case 'p': options.port = atoi(optarg); break;
+    case 'l': options.latency = strtoul(optarg, NULL, 10); break;
+    case 'j': options.jitter = strtoul(optarg, NULL, 10); break;
+    case 'd': options.dropRate = atof(optarg); break;
+    case 'x': options.disconnectRate = atof(optarg); break;
+    case 'f': options.fragmentSize = strtoul(optarg, NULL, 10); break;
+    case 's': statsInterval = strtoul(optarg, NULL, 10) * 1000; break;
+    case 't':
+      if (!serveTls(optarg)) return 1;
+      break;
+    case 'v': options.verbose = true; break;
+    default: usage(argv[0]); return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  signal(SIGINT, [](int) { running = false; });
+  signal(SIGTERM, [](int) { running = false; });
+
+  GrandeurServer server(options);
+  server.begin();
+  printf("Grandeur stand-in server listening on port %u.\n", options.port);
+  fflush(stdout);
+
+  unsigned long lastStats = millis();
+  while (running) {
+    server.loop();
+    if (statsInterval && millis() - lastStats >= statsInterval) {
+      printStats(server.stats());
+      lastStats = millis();
+    }
+    // Sleeping a little keeps an idle server off the CPU.
+    usleep(100);
+  }
+
+  printStats(server.stats());
+  return 0;
+}
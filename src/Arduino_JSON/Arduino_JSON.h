@@ -21,5 +21,6 @@
 #define _ARDUINO_JSON_H_
 
 #include "JSON.h"
+#include "JSONArena.h"
 
 #endif
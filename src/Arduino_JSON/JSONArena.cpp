@@ -0,0 +1,145 @@
+/**
+ * @file JSONArena.cpp
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ */
+
+#include "cjson/cJSON.h"
+
+#include "JSONArena.h"
+
+// cJSON items hold doubles and pointers.
+#define JSON_ARENA_ALIGNMENT (8)
+
+JSONArena* JSONArena::_arenas = NULL;
+JSONArena* JSONArena::_current = NULL;
+
+JSONArena::JSONArena(size_t size) : _block(NULL),
+                                    _size(size),
+                                    _used(0),
+                                    _live(0),
+                                    _next(NULL)
+{
+  if (_size > 0)
+  {
+    _block = (uint8_t*)malloc(_size);
+  }
+  if (_block == NULL)
+  {
+    _size = 0;
+    return;
+  }
+
+  // cJSON keeps going through the heap until the first arena shows up.
+  if (_arenas == NULL)
+  {
+    struct cJSON_Hooks hooks = {
+      hookMalloc,
+      hookFree
+    };
+
+    cJSON_InitHooks(&hooks);
+  }
+  _next = _arenas;
+  _arenas = this;
+}
+
+JSONArena::~JSONArena()
+{
+  for (JSONArena** link = &_arenas; *link != NULL; link = &(*link)->_next)
+  {
+    if (*link == this)
+    {
+      *link = _next;
+      break;
+    }
+  }
+  if (_current == this)
+  {
+    _current = NULL;
+  }
+  free(_block);
+}
+
+size_t JSONArena::size() const
+{
+  return _size;
+}
+
+size_t JSONArena::used() const
+{
+  return _used;
+}
+
+void* JSONArena::allocate(size_t size)
+{
+  size = (size + JSON_ARENA_ALIGNMENT - 1) & ~(size_t)(JSON_ARENA_ALIGNMENT - 1);
+  if (size > _size - _used)
+  {
+    return NULL;
+  }
+
+  void* pointer = _block + _used;
+  _used += size;
+  _live++;
+  return pointer;
+}
+
+bool JSONArena::owns(void* pointer) const
+{
+  return (uint8_t*)pointer >= _block && (uint8_t*)pointer < _block + _size;
+}
+
+void JSONArena::release(void)
+{
+  // Nothing is freed on its own; the block starts over once it's empty.
+  if (--_live == 0)
+  {
+    _used = 0;
+  }
+}
+
+void* JSONArena::hookMalloc(size_t size)
+{
+  if (_current != NULL)
+  {
+    void* pointer = _current->allocate(size);
+    if (pointer != NULL)
+    {
+      return pointer;
+    }
+  }
+  return malloc(size);
+}
+
+void JSONArena::hookFree(void* pointer)
+{
+  if (pointer == NULL)
+  {
+    return;
+  }
+  for (JSONArena* arena = _arenas; arena != NULL; arena = arena->_next)
+  {
+    if (arena->owns(pointer))
+    {
+      arena->release();
+      return;
+    }
+  }
+  free(pointer);
+}
+
+JSONArena::Scope::Scope(JSONArena& arena) : _previous(_current)
+{
+  // An arena without a block leaves allocations to the heap.
+  _current = arena._size > 0 ? &arena : NULL;
+}
+
+JSONArena::Scope::~Scope()
+{
+  _current = _previous;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file JSONArena.h
+ * @date 18.10.2026
+ * @author Grandeur Technologies
+ *
+ * Copyright (c) 2026 Grandeur Technologies Inc. All rights reserved.
+ * This file is part of the Arduino SDK for Grandeur.
+ *
+ */
+
+#ifndef _JSON_ARENA_H_
+#define _JSON_ARENA_H_
+
+#include <Arduino.h>
+
+// Block of memory cJSON allocates from while the arena is in use, instead of making a heap
+// allocation per node and string. Freeing a node in the arena costs nothing, and the whole block
+// is reused once everything allocated in it is freed. Allocations that don't fit go to the heap,
+// so trees may outlive the scope they were built in. The arena has to outlive them though.
+//
+// A single tree kept alive pins the whole block: nothing in it is reused until that tree is
+// freed, and once the rest is used up every allocation goes to the heap again. Copies of a tree
+// made outside a Scope are on the heap, so values that are kept should be copies made there.
+// used() is 0 whenever nothing in the block is alive.
+class JSONArena {
+public:
+  // Makes cJSON allocate from an arena while in scope. Scopes nest. A scope should close before
+  // what's built in it is handed to code that may run callbacks, or they allocate in the arena
+  // too.
+  class Scope {
+  public:
+    Scope(JSONArena& arena);
+    ~Scope();
+
+  private:
+    JSONArena* _previous;
+  };
+
+  JSONArena(size_t size);
+  ~JSONArena();
+
+  size_t size() const;
+  // Bytes taken since the block was last empty.
+  size_t used() const;
+
+private:
+  JSONArena(const JSONArena&);
+  void operator=(const JSONArena&);
+
+  void* allocate(size_t size);
+  bool owns(void* pointer) const;
+  void release(void);
+
+  static void* hookMalloc(size_t size);
+  static void hookFree(void* pointer);
+
+  uint8_t* _block;
+  size_t _size;
+  size_t _used;
+  // Allocations in the block not freed yet.
+  size_t _live;
+  // Arenas are kept in a list, so hookFree() can tell whose memory it's given.
+  JSONArena* _next;
+
+  static JSONArena* _arenas;
+  static JSONArena* _current;
+};
+
+#endif
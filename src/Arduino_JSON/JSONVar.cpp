@@ -68,7 +68,7 @@ JSONVar::JSONVar(const JSONVar &v)
 }
 
 #if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
-JSONVar::JSONVar(JSONVar &&v)
+JSONVar::JSONVar(JSONVar &&v) : JSONVar(NULL, NULL)
 {
   cJSON *tmp;
 
@@ -103,20 +103,172 @@ JSONVar::~JSONVar()
   }
 }
 
-size_t JSONVar::printTo(Print &p) const
+// Counts the bytes printed to it.
+class JSONCounter : public Print
 {
-  if (_json == NULL)
+public:
+  virtual size_t write(uint8_t c)
+  {
+    return 1;
+  }
+
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    return size;
+  }
+};
+
+// Appends what's printed to it to a string.
+class JSONStringPrinter : public Print
+{
+public:
+  JSONStringPrinter(String &str) : _str(str)
+  {
+  }
+
+  virtual size_t write(uint8_t c)
+  {
+    return write(&c, 1);
+  }
+
+  virtual size_t write(const uint8_t *buffer, size_t size)
+  {
+    return _str.concat((const char *)buffer, size) ? size : 0;
+  }
+
+private:
+  String &_str;
+};
+
+static size_t printString(const char *s, Print &p)
+{
+  size_t written = p.write('"');
+
+  if (s != NULL)
+  {
+    const char *run = s;
+
+    for (; *s != '\0'; s++)
+    {
+      unsigned char c = (unsigned char)*s;
+      if (c > 31 && c != '"' && c != '\\')
+      {
+        continue;
+      }
+
+      // Writing the characters up to here in one go, then the escape sequence.
+      written += p.write((const uint8_t *)run, s - run);
+      run = s + 1;
+
+      char escape[7] = {'\\', 0};
+      switch (c)
+      {
+      case '\\':
+      case '"':
+        escape[1] = c;
+        break;
+      case '\b':
+        escape[1] = 'b';
+        break;
+      case '\f':
+        escape[1] = 'f';
+        break;
+      case '\n':
+        escape[1] = 'n';
+        break;
+      case '\r':
+        escape[1] = 'r';
+        break;
+      case '\t':
+        escape[1] = 't';
+        break;
+      default:
+        sprintf(escape + 1, "u%04x", c);
+        break;
+      }
+      written += p.write(escape);
+    }
+    written += p.write((const uint8_t *)run, s - run);
+  }
+
+  return written + p.write('"');
+}
+
+static size_t printNumber(double d, Print &p)
+{
+  char number[26];
+
+  // NaN and infinity.
+  if ((d * 0) != 0)
+  {
+    return p.write("null");
+  }
+
+  // Printing with 15 digits unless it takes 17 to get the number back.
+  double test;
+  int length = snprintf(number, sizeof(number), "%1.15g", d);
+  if (sscanf(number, "%lg", &test) != 1 || test != d)
+  {
+    length = snprintf(number, sizeof(number), "%1.17g", d);
+  }
+  if (length < 0 || length >= (int)sizeof(number))
   {
     return 0;
   }
 
-  char *s = cJSON_PrintUnformatted(_json);
+  return p.write((const uint8_t *)number, length);
+}
 
-  size_t writen = p.print(s);
+static size_t printJson(const cJSON *item, Print &p)
+{
+  size_t written = 0;
 
-  cJSON_free(s);
+  switch (item->type & 0xFF)
+  {
+  case cJSON_NULL:
+    return p.write("null");
+  case cJSON_False:
+    return p.write("false");
+  case cJSON_True:
+    return p.write("true");
+  case cJSON_Number:
+    return printNumber(item->valuedouble, p);
+  case cJSON_Raw:
+    return item->valuestring != NULL ? p.write(item->valuestring) : 0;
+  case cJSON_String:
+    return printString(item->valuestring, p);
+  case cJSON_Array:
+    written += p.write('[');
+    for (const cJSON *child = item->child; child != NULL; child = child->next)
+    {
+      if (child != item->child)
+      {
+        written += p.write(',');
+      }
+      written += printJson(child, p);
+    }
+    return written + p.write(']');
+  case cJSON_Object:
+    written += p.write('{');
+    for (const cJSON *child = item->child; child != NULL; child = child->next)
+    {
+      if (child != item->child)
+      {
+        written += p.write(',');
+      }
+      written += printString(child->string, p);
+      written += p.write(':');
+      written += printJson(child, p);
+    }
+    return written + p.write('}');
+  default:
+    return 0;
+  }
+}
 
-  return writen;
+size_t JSONVar::printTo(Print &p) const
+{
+  return stringifyTo(p);
 }
 
 JSONVar::operator bool() const
@@ -136,7 +288,8 @@ JSONVar::operator long() const
 
 JSONVar::operator unsigned long() const
 {
-  return cJSON_IsNumber(_json) ? _json->valueint : 0;
+  // valueint saturates at INT_MAX, while valuedouble holds integers up to 2^53 exactly.
+  return cJSON_IsNumber(_json) && _json->valuedouble > 0 ? (unsigned long)_json->valuedouble : 0;
 }
 
 JSONVar::operator double() const
@@ -179,6 +332,16 @@ void JSONVar::operator=(const JSONVar &v)
 #if __cplusplus >= 201103L || defined(__GXX_EXPERIMENTAL_CXX0X__)
 JSONVar &JSONVar::operator=(JSONVar &&v)
 {
+  // Moving a tree of its own into an item of another tree puts it in place of the item,
+  // rather than swapping, which would leave both trees as they are.
+  if (_parent != NULL && v._parent == NULL && v._json != NULL)
+  {
+    replaceJson(v._json);
+    v._json = NULL;
+
+    return *this;
+  }
+
   cJSON *tmp;
 
   // swap _json
@@ -387,15 +550,58 @@ String JSONVar::stringify(const JSONVar &value)
     return String((const char *)NULL);
   }
 
-  char *s = cJSON_PrintUnformatted(value._json);
-
-  String str = s;
+  // Measuring first, so the string is allocated once.
+  String str;
+  str.reserve(value.stringifiedLength());
 
-  cJSON_free(s);
+  JSONStringPrinter printer(str);
+  value.stringifyTo(printer);
 
   return str;
 }
 
+// Prints into a caller owned buffer without allocating. Returns the length printed, or size if
+// it didn't fit.
+size_t JSONVar::stringifyTo(char *buffer, size_t size) const
+{
+  if (size == 0)
+  {
+    return 0;
+  }
+
+  if (_json == NULL)
+  {
+    buffer[0] = '\0';
+
+    return 0;
+  }
+
+  if (!cJSON_PrintPreallocated(_json, buffer, size, false))
+  {
+    return size;
+  }
+
+  return strlen(buffer);
+}
+
+// Prints without a buffer of its own, the same way cJSON_PrintUnformatted() does.
+size_t JSONVar::stringifyTo(Print &p) const
+{
+  if (_json == NULL)
+  {
+    return 0;
+  }
+
+  return printJson(_json, p);
+}
+
+size_t JSONVar::stringifiedLength() const
+{
+  JSONCounter counter;
+
+  return stringifyTo(counter);
+}
+
 String JSONVar::typeof_(const JSONVar &value)
 {
   struct cJSON *json = value._json;
@@ -434,6 +640,33 @@ String JSONVar::typeof_(const JSONVar &value)
   }
 }
 
+JSONType JSONVar::type() const
+{
+  if (_json == NULL)
+  {
+    return JSON_UNDEFINED;
+  }
+
+  switch (_json->type & 0xFF)
+  {
+  case cJSON_False:
+  case cJSON_True:
+    return JSON_BOOLEAN;
+  case cJSON_NULL:
+    return JSON_NULL;
+  case cJSON_Number:
+    return JSON_NUMBER;
+  case cJSON_String:
+    return JSON_STRING;
+  case cJSON_Array:
+    return JSON_ARRAY;
+  case cJSON_Object:
+    return JSON_OBJECT;
+  default:
+    return JSON_UNDEFINED;
+  }
+}
+
 void JSONVar::replaceJson(struct cJSON *json)
 {
   cJSON *old = _json;
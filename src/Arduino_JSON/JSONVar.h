@@ -27,6 +27,16 @@ struct cJSON;
 #define typeof typeof_
 #define null nullptr
 
+enum JSONType {
+  JSON_UNDEFINED,
+  JSON_NULL,
+  JSON_BOOLEAN,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT
+};
+
 class JSONVar : public Printable {
 public:
   JSONVar();
@@ -83,7 +93,18 @@ public:
   static JSONVar parse(const char* s);
   static JSONVar parse(const String& s);
   static String stringify(const JSONVar& value);
+  size_t stringifyTo(char* buffer, size_t size) const;
+  size_t stringifyTo(Print& p) const;
+  size_t stringifiedLength() const;
   static String typeof_(const JSONVar& value);
+  JSONType type() const;
+  bool isUndefined() const { return type() == JSON_UNDEFINED; }
+  bool isNull() const { return type() == JSON_NULL; }
+  bool isBoolean() const { return type() == JSON_BOOLEAN; }
+  bool isNumber() const { return type() == JSON_NUMBER; }
+  bool isString() const { return type() == JSON_STRING; }
+  bool isArray() const { return type() == JSON_ARRAY; }
+  bool isObject() const { return type() == JSON_OBJECT; }
 
 private:
   JSONVar(struct cJSON* json, struct cJSON* parent);
@@ -1,45 +1,116 @@
 #include "debug.h"
 #include "Var.h"
+#include <functional>
+#include <type_traits>
 
 #ifndef CALLBACK_H_
 #define CALLBACK_H_
 
+// Converts the packet to the type of a callback's second argument, checking its JSON type first.
+template <typename T>
+struct CallbackArgument {
+  static_assert(sizeof(T) == 0, "Callback's second argument must be Var, bool, int, double or const char*.");
+};
+
+template <>
+struct CallbackArgument<Var> {
+  static const char* name() { return "var"; }
+  static bool accepts(const Var& packet) { return true; }
+  static const Var& get(const Var& packet) { return packet; }
+};
+
+template <>
+struct CallbackArgument<bool> {
+  static const char* name() { return "boolean"; }
+  static bool accepts(const Var& packet) { return packet.isBoolean(); }
+  static bool get(const Var& packet) { return (bool)packet; }
+};
+
+template <>
+struct CallbackArgument<int> {
+  static const char* name() { return "int"; }
+  // Numbers with a fraction go to double callbacks only.
+  static bool accepts(const Var& packet) {
+    return packet.isNumber() && (double)packet - (int)packet == 0;
+  }
+  static int get(const Var& packet) { return (int)packet; }
+};
+
+template <>
+struct CallbackArgument<double> {
+  static const char* name() { return "double"; }
+  static bool accepts(const Var& packet) { return packet.isNumber(); }
+  static double get(const Var& packet) { return (double)packet; }
+};
+
+template <>
+struct CallbackArgument<const char*> {
+  static const char* name() { return "string"; }
+  static bool accepts(const Var& packet) { return packet.isString(); }
+  static const char* get(const Var& packet) { return (const char*)packet; }
+};
+
+// Argument types of a function, function pointer, lambda or std::function.
+template <typename... A>
+struct CallbackArguments {};
+
+template <typename F>
+struct CallbackSignature : CallbackSignature<decltype(&F::operator())> {};
+
+template <typename R, typename... A>
+struct CallbackSignature<R (*)(A...)> {
+  typedef CallbackArguments<typename std::decay<A>::type...> Arguments;
+};
+
+template <typename C, typename R, typename... A>
+struct CallbackSignature<R (C::*)(A...)> {
+  typedef CallbackArguments<typename std::decay<A>::type...> Arguments;
+};
+
+template <typename C, typename R, typename... A>
+struct CallbackSignature<R (C::*)(A...) const> {
+  typedef CallbackArguments<typename std::decay<A>::type...> Arguments;
+};
+
 class Callback {
-	private:
-    // Stores pointer to the function.
-		void* _functionPtr;
-    // Stores the number of function arguments.
-    int _nArgs;
-    // Stores the type of function arguments.
-    int _type;
-    // Returns function type as string.
-    const char* mapType(int type);
+  private:
+    // Calls the user's function with the packet converted to the type it takes. The conversion
+    // is picked when the callback is constructed.
+    std::function<void(const char*, const Var&)> _function;
+
     // Prints error to the debug port.
-    void printError(String type);
+    static void printError(const char* expected, const Var& packet);
 
-	public:
+    template <typename F>
+    static std::function<void(const char*, const Var&)> adapt(F f, CallbackArguments<const char*>) {
+      return [f](const char* str, const Var& packet) mutable { f(str); };
+    }
+
+    template <typename F, typename T>
+    static std::function<void(const char*, const Var&)> adapt(F f, CallbackArguments<const char*, T>) {
+      return [f](const char* str, const Var& packet) mutable {
+        if (!CallbackArgument<T>::accepts(packet))
+          return printError(CallbackArgument<T>::name(), packet);
+        f(str, CallbackArgument<T>::get(packet));
+      };
+    }
+
+  public:
     // Default constructor
     Callback();
     Callback(int ptr);
-    // For string argument
-    Callback(void c(const char*));
-    // For string and Var arguments
-    Callback(void c(const char*, Var));
-    // For string and bool arguments
-    Callback(void c(const char*, bool));
-    // For string and int arguments
-    Callback(void c(const char*, int));
-    // For string and double arguments
-    Callback(void c(const char*, double));
-    // For string and string arguments
-    Callback(void c(const char*, const char*));
-
-		// This overrides the function call operator to pass data to the function our _functionPtr
-    // points to.
-    void operator()(const char* str, Var packet);
+    // For functions, lambdas and std::functions taking a string, or a string and one of Var, bool,
+    // int, double or string. Lambdas may capture.
+    template <typename F,
+              typename = typename std::enable_if<(std::is_class<F>::value || std::is_pointer<F>::value) &&
+                                                 !std::is_same<F, Callback>::value>::type>
+    Callback(F f) : _function(adapt(f, typename CallbackSignature<F>::Arguments())) {}
+
+    // This overrides the function call operator to pass data to the function.
+    void operator()(const char* str, const Var& packet);
 
     // This overrides not operator: !callback.
     bool operator!();
 };
 
-#endif
\ No newline at end of file
+#endif
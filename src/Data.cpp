@@ -10,7 +10,7 @@
 
 #include "Grandeur.h"
 
-Grandeur::Project::Device::Event::Event() {}
+Grandeur::Project::Device::Event::Event() : _duplex(NULL), _id(0) {}
 
 Grandeur::Project::Device::Event::Event(
   DuplexHandler* duplexHandler,
@@ -20,13 +20,22 @@ Grandeur::Project::Device::Event::Event(
   gId id
 ) : _duplex(duplexHandler), _deviceId(deviceId), _event(event), _path(path), _id(id) {}
 
+bool Grandeur::Project::Device::Event::isListening() {
+  return _id != 0;
+}
+
 void Grandeur::Project::Device::Event::clear() {
+  // A listener that was turned down has nothing to clear.
+  if (_id == 0) return;
   // Clear an event handler on path
-  // Prepare the message payload.
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
-  oPayload["event"] = _event;
-  oPayload["path"] = _path;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+    oPayload["event"] = _event;
+    oPayload["path"] = _path;
+  }
 
   // Unsubscribing from the event.
   _duplex->unsubscribe((_event + "/" + _path).c_str(), _id, oPayload);
@@ -38,52 +47,89 @@ Grandeur::Project::Device::Data::Data(DuplexHandler* duplexHandler, String devic
 : _duplex(duplexHandler), _deviceId(deviceId) {}
 
 void Grandeur::Project::Device::Data::get(const char* path, Callback cb) {
-  // Prepare the message payload.
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
-  oPayload["path"] = path;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+    oPayload["path"] = path;
+  }
 
   // Sending the packet and scheduling callback.
   _duplex->send("/device/data/get", oPayload, cb);
 }
 
 void Grandeur::Project::Device::Data::get(Callback cb) {
-  // Prepare the message payload.
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+  }
 
   // Sending the packet and scheduling callback.
   _duplex->send("/device/data/get", oPayload, cb);
 }
 
 void Grandeur::Project::Device::Data::set(const char* path, Var data, Callback cb) {
-  // Prepare the message payload.
+  // Holding the update back when coalescing, so that it replaces earlier sets of the path. It's
+  // kept for the whole window, so its payload is built on the heap instead of in the arena.
+  if (_duplex->isCoalescing()) {
+    Var oPayload;
+    oPayload["deviceID"] = _deviceId;
+    oPayload["path"] = path;
+    oPayload["data"] = std::move(data);
+    _duplex->sendCoalesced("/device/data/set", _deviceId + "/" + path, std::move(oPayload), cb);
+    return;
+  }
+
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
-  oPayload["path"] = path;
-  oPayload["data"] = data;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+    oPayload["path"] = path;
+    oPayload["data"] = std::move(data);
+  }
 
   // Sending the packet and scheduling callback.
   _duplex->send("/device/data/set", oPayload, cb);
 }
 
 void Grandeur::Project::Device::Data::set(const char* path, Var data) {
-  // Prepare the message payload.
+  // Holding the update back when coalescing, so that it replaces earlier sets of the path. It's
+  // kept for the whole window, so its payload is built on the heap instead of in the arena.
+  if (_duplex->isCoalescing()) {
+    Var oPayload;
+    oPayload["deviceID"] = _deviceId;
+    oPayload["path"] = path;
+    oPayload["data"] = std::move(data);
+    _duplex->sendCoalesced("/device/data/set", _deviceId + "/" + path, std::move(oPayload), Callback());
+    return;
+  }
+
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
-  oPayload["path"] = path;
-  oPayload["data"] = data;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+    oPayload["path"] = path;
+    oPayload["data"] = std::move(data);
+  }
 
   // Sending the packet without response.
   _duplex->send("/device/data/set", oPayload);
 }
 
 Grandeur::Project::Device::Event Grandeur::Project::Device::Data::on(const char* path, Callback cb) {
-  // Prepare the message payload.
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
-  oPayload["event"] = "data";
-  oPayload["path"] = path;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+    oPayload["event"] = "data";
+    oPayload["path"] = path;
+  }
   
   // Send 
   gId eventId = _duplex->subscribe(("data/" + String(path)).c_str(), oPayload, cb);
@@ -93,14 +139,17 @@ Grandeur::Project::Device::Event Grandeur::Project::Device::Data::on(const char*
 }
 
 Grandeur::Project::Device::Event Grandeur::Project::Device::Data::on(Callback cb) {
-  // Prepare the message payload.
+  // Prepare the message payload in the arena of the duplex channel.
   Var oPayload;
-  oPayload["deviceID"] = _deviceId;
-  oPayload["event"] = "data";
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    oPayload["deviceID"] = _deviceId;
+    oPayload["event"] = "data";
+  }
   
   // Send 
   gId eventId = _duplex->subscribe("data/", oPayload, cb);
 
   // Return the event object to let the user unsubscribe to this event at a later time.
   return Event(_duplex, _deviceId, "data", "", eventId);
-}
\ No newline at end of file
+}
\ No newline at end of file
@@ -26,9 +26,12 @@ Grandeur::Project::Datastore::Collection::Collection(String name, DuplexHandler*
 void Grandeur::Project::Datastore::Collection::insert(Var documents, Callback inserted) {
   // Insert documents to datastore
   Var oPayload;
-  // Append collection name and documents
-  oPayload["collection"] = _name;
-  oPayload["documents"] = documents;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    // Append collection name and documents
+    oPayload["collection"] = _name;
+    oPayload["documents"] = std::move(documents);
+  }
 
   // Send request to server
   _duplex->send("/datastore/insert", oPayload, inserted);
@@ -37,9 +40,12 @@ void Grandeur::Project::Datastore::Collection::insert(Var documents, Callback in
 void Grandeur::Project::Datastore::Collection::remove(Var filter, Callback removed) {
   // Remove documents from datastore
   Var oPayload;
-  // Append collection name and filter
-  oPayload["collection"] = _name;
-  oPayload["filter"] = filter;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    // Append collection name and filter
+    oPayload["collection"] = _name;
+    oPayload["filter"] = std::move(filter);
+  }
 
   // Send request to server
   _duplex->send("/datastore/delete", oPayload, removed);
@@ -48,9 +54,12 @@ void Grandeur::Project::Datastore::Collection::remove(Var filter, Callback remov
 void Grandeur::Project::Datastore::Collection::update(Var filter, Var update, Callback updated) {
   // Update document from datastore
   Var oPayload;
-  // Append collection name, filter and update
-  oPayload["collection"] = _name;
-  oPayload["filter"] = filter;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    // Append collection name, filter and update
+    oPayload["collection"] = _name;
+    oPayload["filter"] = std::move(filter);
+  }
 
   // Send request to server
   _duplex->send("/datastore/update", oPayload, updated);
@@ -87,7 +96,7 @@ Grandeur::Project::Datastore::Collection::Pipeline Grandeur::Project::Datastore:
 
   // Add type and filter
   _query[stage]["type"] = "match";
-  _query[stage]["filter"] = filter;
+  _query[stage]["filter"] = std::move(filter);
 
   // Return reference to pipeline to basically help in chaining
   return Pipeline(_collection, _query, _duplex);
@@ -99,7 +108,7 @@ Grandeur::Project::Datastore::Collection::Pipeline Grandeur::Project::Datastore:
 
   // Add type and specs
   _query[stage]["type"] = "match";
-  _query[stage]["specs"] = specs;
+  _query[stage]["specs"] = std::move(specs);
 
   // Return reference to pipeline to basically help in chaining
   return Pipeline(_collection, _query, _duplex);
@@ -111,8 +120,8 @@ Grandeur::Project::Datastore::Collection::Pipeline Grandeur::Project::Datastore:
 
   // Add type, condition and fields
   _query[stage]["type"] = "match";
-  _query[stage]["condition"] = condition;
-  _query[stage]["fields"] = fields;
+  _query[stage]["condition"] = std::move(condition);
+  _query[stage]["fields"] = std::move(fields);
 
   // Return reference to pipeline to basically help in chaining
   return Pipeline(_collection, _query, _duplex);
@@ -124,7 +133,7 @@ Grandeur::Project::Datastore::Collection::Pipeline Grandeur::Project::Datastore:
 
   // Add type and specs
   _query[stage]["type"] = "match";
-  _query[stage]["specs"] = specs;
+  _query[stage]["specs"] = std::move(specs);
 
   // Return reference to pipeline to basically help in chaining
   return Pipeline(_collection, _query, _duplex);
@@ -133,10 +142,13 @@ Grandeur::Project::Datastore::Collection::Pipeline Grandeur::Project::Datastore:
 void Grandeur::Project::Datastore::Collection::Pipeline::execute(int nPage, Callback executed) {
   // Define an object
   Var oPayload;
-  // Formulate query
-  oPayload["collection"] = _collection;
-  oPayload["pipeline"] = _query;
-  oPayload["nPage"] = nPage;
+  {
+    JSONArena::Scope scope(_duplex->arena());
+    // Formulate query
+    oPayload["collection"] = _collection;
+    oPayload["pipeline"] = _query;
+    oPayload["nPage"] = nPage;
+  }
 
   // Send to server
   _duplex->send("/datastore/pipeline", oPayload, executed);
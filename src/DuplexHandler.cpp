@@ -11,11 +11,189 @@
 #include <regex>
 #include "DuplexHandler.h"
 
-// Init ping counter
-unsigned long timeSinceLastMessage = 0;
+// Helpers to pick the header out of a raw message without parsing it. They rely on the message
+// being null terminated, which it is as it comes from the websockets client.
+static const char *skipSpace(const char *p)
+{
+  while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+    p++;
+  return p;
+}
+
+// Returns past the closing quote of the string p points to, or NULL if it isn't terminated.
+static const char *skipString(const char *p)
+{
+  for (p++; *p; p++)
+  {
+    if (*p == '\\' && p[1])
+      p++;
+    else if (*p == '"')
+      return p + 1;
+  }
+  return NULL;
+}
+
+// Returns past the value p points to, or NULL if it isn't terminated.
+static const char *skipValue(const char *p)
+{
+  if (*p == '"')
+    return skipString(p);
+
+  if (*p == '{' || *p == '[')
+  {
+    int depth = 0;
+    while (*p)
+    {
+      if (*p == '"')
+      {
+        p = skipString(p);
+        if (p == NULL)
+          return NULL;
+        continue;
+      }
+      if (*p == '{' || *p == '[')
+        depth++;
+      else if ((*p == '}' || *p == ']') && --depth == 0)
+        return p + 1;
+      p++;
+    }
+    return NULL;
+  }
+
+  // Numbers, booleans and null run up to the next delimiter.
+  while (*p && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+    p++;
+  return p;
+}
+
+// Returns past the opening brace of the object p points to, or NULL if it isn't one.
+static const char *enterObject(const char *p)
+{
+  p = skipSpace(p);
+  return *p == '{' ? p + 1 : NULL;
+}
+
+// Reads the next key of an object and moves p to its value. Returns false at the end of the
+// object or if it's malformed.
+static bool nextKey(const char **p, const char **key, size_t *keyLength)
+{
+  const char *q = skipSpace(*p);
+  if (*q == ',')
+    q = skipSpace(q + 1);
+  if (*q != '"')
+    return false;
+
+  *key = q + 1;
+  q = skipString(q);
+  if (q == NULL)
+    return false;
+  *keyLength = q - 1 - *key;
+
+  q = skipSpace(q);
+  if (*q != ':')
+    return false;
+  *p = skipSpace(q + 1);
+  return true;
+}
+
+static bool equals(const char *s, size_t length, const char *literal)
+{
+  return strlen(literal) == length && strncmp(s, literal, length) == 0;
+}
+
+// Finds header.task and header.id of a message. The task is left in place, so it isn't null
+// terminated. Returns false if the message doesn't have both.
+static bool scanHeader(const char *message, const char **task, size_t *taskLength, gId *id)
+{
+  const char *key;
+  size_t keyLength;
+  const char *p = enterObject(message);
+
+  while (p && nextKey(&p, &key, &keyLength))
+  {
+    if (!equals(key, keyLength, "header"))
+    {
+      p = skipValue(p);
+      continue;
+    }
+
+    bool hasTask = false;
+    bool hasId = false;
+    const char *q = enterObject(p);
+    while (q && nextKey(&q, &key, &keyLength))
+    {
+      if (equals(key, keyLength, "task") && *q == '"')
+      {
+        const char *end = skipString(q);
+        // Escaped task names are left to the parser.
+        if (end && memchr(q + 1, '\\', end - q - 1) == NULL)
+        {
+          *task = q + 1;
+          *taskLength = end - q - 2;
+          hasTask = true;
+        }
+      }
+      else if (equals(key, keyLength, "id"))
+      {
+        char *end;
+        double number = strtod(q, &end);
+        if (end != q)
+        {
+          *id = (gId)number;
+          hasId = true;
+        }
+      }
+      q = skipValue(q);
+    }
+
+    // Nothing after the header is of interest.
+    return hasTask && hasId;
+  }
+
+  return false;
+}
+
+// Gives back what a buffer grew past size. It's kept as it is if the heap can't move it.
+static void shrinkBuffer(char **buffer, size_t *bufferSize, size_t size)
+{
+  if (*bufferSize <= size)
+    return;
+
+  char *shrunk = (char *)realloc(*buffer, size);
+  if (shrunk == NULL)
+    return;
+  *buffer = shrunk;
+  *bufferSize = size;
+}
 
 DuplexHandler::DuplexHandler() : _query("/?type=device"), _token(""), _status(DISCONNECTED),
-                                 _connectionHandler([](bool status) {}) {}
+                                 _connectionHandler([](bool status) {}), _attemptHandler(NULL),
+                                 _requests(REQUESTS_MAX),
+                                 _arena(JSON_ARENA_SIZE),
+                                 _sendBuffer(NULL),
+                                 _sendBufferSize(0), _batching(false), _batchWindow(0),
+                                 _batchStart(0), _batchLength(0), _receiveBuffer(NULL), _receiveBufferSize(0),
+                                 _receiveLength(0), _receiving(false), _nPending(0), _coalescing(false),
+                                 _coalesceWindow(0), _coalesceStart(0), _keepalive(PING_INTERVAL),
+                                 _heartbeat(false), _lastTraffic(0), _flushing(false), _flushedSubscription(0),
+                                 _flushedMessage(0), _streamId(0), _streamTask(NULL), _streamSent(0),
+                                 _buffer(BUFFER_SIZE, BUFFER_MESSAGES, BUFFER_OVERFLOW),
+                                 _subscriptionBuffer(SUBSCRIPTION_BUFFER_SIZE, SUBSCRIPTION_BUFFER_MESSAGES,
+                                                     BUFFER_REJECT, SUBSCRIPTION_BUFFER_MAX_SIZE,
+                                                     SUBSCRIPTION_BUFFER_MAX_MESSAGES) {}
+
+DuplexHandler::~DuplexHandler()
+{
+  // The client outlives the other members and reports its disconnection while it goes.
+  _client.onEvent(nullptr);
+  free(_sendBuffer);
+  free(_receiveBuffer);
+}
+
+JSONArena &DuplexHandler::arena(void)
+{
+  return _arena;
+}
 
 void DuplexHandler::init(Config config)
 {
@@ -24,17 +202,35 @@ void DuplexHandler::init(Config config)
   // Setting up event handler
   _client.onEvent([=](WStype_t eventType, uint8_t *message, size_t length)
                   { duplexEventHandler(eventType, message, length); });
-  // Scheduling reconnect every 5 seconds if it disconnects
-  _client.setReconnectInterval(5000);
+  // Letting the senders of messages dropped from the buffer know once it's done making room.
+  _buffer.onDrop([=](gId id)
+                 { _dropped.push_back(id); });
+  // Reconnecting right away when the connection drops, then backing off at random up to
+  // RECONNECT_MAX, so that devices don't all come back at once when Grandeur does.
+  _client.setReconnectBackoff(RECONNECT_MIN, RECONNECT_MAX);
+  _client.onConnectAttempt([=](bool connected, unsigned long connectTime, unsigned long handshakeTime)
+                           {
+                             DEBUG_GRANDEUR("Connection attempt %s:: connect %lu ms, handshake %lu ms.",
+                                            connected ? "succeeded" : "failed", connectTime, handshakeTime);
+                             if (_attemptHandler)
+                               _attemptHandler(connected, connectTime, handshakeTime);
+                           });
 
   DEBUG_GRANDEUR("Initializing duplex channel.");
 
   // Opening up the connection.
+#if defined(HAS_SSL) && GRANDEUR_SSL
   _client.beginSSL(GRANDEUR_URL, GRANDEUR_PORT, _query.c_str(), GRANDEUR_FINGERPRINT, "node");
+#else
+  _client.begin(GRANDEUR_URL, GRANDEUR_PORT, _query.c_str(), "node");
+#endif
   // Setting auth header.
   char tokenArray[_token.length() + 1];
   _token.toCharArray(tokenArray, _token.length() + 1);
   _client.setAuthorization(tokenArray);
+
+  // Allocating the send buffer up front, so that sending doesn't touch the heap.
+  growSendBuffer();
 }
 
 void DuplexHandler::loop(bool valve)
@@ -42,174 +238,648 @@ void DuplexHandler::loop(bool valve)
   if (valve)
   {
     // If valve is true => valve is open
-    if (millis() - timeSinceLastMessage >= PING_INTERVAL)
+    // Answering requests whose responses are overdue.
+    gId id;
+    Callback cb;
+    while (_requests.takeExpired(millis(), &id, &cb))
+    {
+      DEBUG_GRANDEUR("Request timed out:: Id: %lu.", id);
+      // A request that is still buffered shouldn't go out anymore.
+      _buffer.remove(id);
+      cb("REQUEST-TIMED-OUT", undefined);
+    }
+    // Pinging Grandeur once nothing has gone either way for the keepalive interval. The
+    // websockets client does it with the heartbeat. Not while the buffers are being sent, as the
+    // ping would be buffered behind them, and sent again on every reconnect since its response
+    // doesn't take it out of the buffer.
+    if (_status == CONNECTED && !_flushing && !_heartbeat && _keepalive > 0 &&
+        millis() - _lastTraffic >= _keepalive)
     {
-      // Ping Grandeur if PING_INTERVAL milliseconds have passed.
-      timeSinceLastMessage = millis();
-
       DEBUG_GRANDEUR("Pinging Grandeur.");
       send("ping");
     }
+    // Sending what's held back for coalescing once its window has passed.
+    if (_nPending > 0 && millis() - _coalesceStart >= _coalesceWindow)
+      flushPending();
+    // Sending the batch once its window has passed.
+    if (_batchLength > 0 && millis() - _batchStart >= _batchWindow)
+      flushBatch();
+    // Sending what's left of the streamed message and of the buffers.
+    if (_flushing)
+      flushBuffers();
     // Running duplex loop
     _client.loop();
   }
 }
 
-Message DuplexHandler::prepareMessage(const char *task)
+size_t DuplexHandler::prepareMessage(gId id, const char *task)
 {
-  // Generate a new message id.
-  gId messageId = gid();
-  // Creating new message.
-  Var oMessage;
-  oMessage["header"]["id"] = messageId;
-  oMessage["header"]["task"] = task;
+  do
+  {
+    char *message = preparedMessage();
+    size_t size = sendRoom();
+    int length = snprintf(message, size, "{\"header\":{\"id\":%lu,\"task\":\"%s\"}}", id, task);
 
-  return {messageId, JSON.stringify(oMessage)};
+    if (length > 0 && (size_t)length < size)
+      return length;
+  } while (makeRoom());
+
+  return 0;
 }
 
-Message DuplexHandler::prepareMessage(const char *task, Var payload)
+size_t DuplexHandler::prepareMessage(gId id, const char *task, const Var &payload, size_t limit)
 {
-  // Generate a new message id.
-  gId messageId = gid();
-  // Creating new message.
-  Var oMessage;
-  oMessage["header"]["id"] = messageId;
-  oMessage["header"]["task"] = task;
-  oMessage["payload"] = payload;
+  static const char payloadKey[] = ",\"payload\":";
+  size_t needed = 0;
 
-  // Preparing message string.
-  String message = JSON.stringify(oMessage);
-  DEBUG_GRANDEUR("Prepared message:: message: %s.", message.c_str());
+  do
+  {
+    char *message = preparedMessage();
+    size_t size = sendRoom();
+    // Printing the header without its closing brace and the payload right where it goes behind
+    // the payload key.
+    int header = snprintf(message, size, "{\"header\":{\"id\":%lu,\"task\":\"%s\"}", id, task);
+    size_t offset = header + sizeof(payloadKey) - 1;
+    if (header <= 0 || offset >= size)
+      continue;
 
-  return {messageId, message};
+    size_t printed = payload.stringifyTo(message + offset, size - offset);
+    // Leaving room for the closing brace and the terminator. A payload that doesn't fit is
+    // measured, so that the buffer grows to its size at once, or not at all if it never fits.
+    if (offset + printed + 1 >= size)
+    {
+      if (needed == 0)
+        needed = offset + payload.stringifiedLength() + 2;
+      continue;
+    }
+
+    // An undefined payload is left out of the message.
+    if (printed == 0)
+    {
+      strcpy(message + header, "}");
+      return header + 1;
+    }
+
+    memcpy(message + header, payloadKey, sizeof(payloadKey) - 1);
+    strcpy(message + offset + printed, "}");
+
+    DEBUG_GRANDEUR("Prepared message:: message: %s.", message);
+    return offset + printed + 1;
+  } while (makeRoom(needed, limit));
+
+  return 0;
 }
 
-void DuplexHandler::sendMessage(const char *message)
+bool DuplexHandler::growSendBuffer(size_t room, size_t limit)
 {
-  // Returning if channel isn't alive.
-  if (_status != CONNECTED)
+  // Besides the message, the buffer holds the frame header and the batch.
+  size_t used = _sendBuffer ? _sendBufferSize - sendRoom() : WEBSOCKETS_MAX_HEADER_SIZE;
+  size_t size = _sendBufferSize ? _sendBufferSize * 2 : MESSAGE_SIZE;
+  if (size < used + room)
+    size = used + room;
+  if (size > limit)
+    size = limit;
+  if (size <= _sendBufferSize || size < used + room)
+    return false;
+
+  char *buffer = (char *)realloc(_sendBuffer, size);
+  if (buffer == NULL)
+    return false;
+
+  _sendBuffer = buffer;
+  _sendBufferSize = size;
+  return true;
+}
+
+bool DuplexHandler::makeRoom(size_t room, size_t limit)
+{
+  if (_batchLength == 0)
+    return growSendBuffer(room, limit);
+
+  // A batch may grow the send buffer up to BATCH_SIZE, beyond that it's sent to make room.
+  if (_sendBufferSize < BATCH_SIZE && growSendBuffer(room))
+    return true;
+
+  flushBatch();
+  return true;
+}
+
+char *DuplexHandler::preparedMessage(void)
+{
+  // When batching, the message goes behind the batch and the byte for its '[' or ','.
+  return _sendBuffer + WEBSOCKETS_MAX_HEADER_SIZE + (_batching ? _batchLength + 1 : 0);
+}
+
+size_t DuplexHandler::sendRoom(void)
+{
+  if (_sendBuffer == NULL)
+    return 0;
+
+  // Batching takes one byte for the separator in front of the message and one for the closing
+  // bracket, which ends up where the terminator of the last message was.
+  return _sendBufferSize - WEBSOCKETS_MAX_HEADER_SIZE - (_batching ? _batchLength + 2 : 0);
+}
+
+void DuplexHandler::sendPrepared(gId id, size_t length)
+{
+  if (length == 0)
+  {
+    DEBUG_GRANDEUR("Message doesn't fit in %d bytes. Dropping it.", MESSAGE_MAX_SIZE);
+    Callback cb;
+    if (_requests.take(id, &cb))
+      cb("MESSAGE-TOO-LARGE", undefined);
+    shrinkSendBuffer();
+    return;
+  }
+
+  // If channel isn't connected yet, or the buffers are still being sent since it connected,
+  // buffer the message and return.
+  if (_status != CONNECTED || _flushing)
+  {
+    if (!_buffer.push(id, preparedMessage()))
+    {
+      DEBUG_GRANDEUR("Buffer is full. Dropping message:: %s.", preparedMessage());
+      _dropped.push_back(id);
+    }
+    answerDropped();
+    shrinkSendBuffer();
     return;
+  }
 
-  // Resetting timeSinceLastMessage.
-  //timeSinceLastMessage = millis();
+  // Adding the message to the batch, behind an opening bracket or a comma.
+  if (_batching)
+  {
+    char *batch = _sendBuffer + WEBSOCKETS_MAX_HEADER_SIZE;
+    if (_batchLength == 0)
+      _batchStart = millis();
+    batch[_batchLength] = _batchLength == 0 ? '[' : ',';
+    _batchLength += length + 1;
+    _batchIds.push_back(id);
+    return;
+  }
 
-  DEBUG_GRANDEUR("Sending message:: %s.", message);
-  // Sending on channel.
-  _client.sendTXT(message);
+  DEBUG_GRANDEUR("Sending message:: %s.", preparedMessage());
+  // The frame header is put in front of the message in the send buffer. The message is masked
+  // in place, so it can't be read after this.
+  _lastTraffic = millis();
+  if (!_client.sendTXT((uint8_t *)_sendBuffer, length, true))
+    sendFailed(id);
+  shrinkSendBuffer();
 }
 
-Message DuplexHandler::send(const char *task, Callback cb)
+void DuplexHandler::shrinkSendBuffer(void)
 {
-  // Preparing a new message.
-  Message message = prepareMessage(task);
+  // Only once the buffer holds nothing, and not below what a batch takes before it's sent.
+  if (_batchLength == 0 && _streamId == 0)
+    shrinkBuffer(&_sendBuffer, &_sendBufferSize, _batching ? BATCH_SIZE : MESSAGE_SIZE);
+}
 
-  // Adding task to receive the response message.
-  _tasks.once(message.id, cb);
+void DuplexHandler::answerDropped(void)
+{
+  // The callbacks may send and drop more messages, which are answered along.
+  Callback cb;
+  for (size_t i = 0; i < _dropped.size(); i++)
+    if (_requests.take(_dropped[i], &cb))
+      cb("BUFFER-FULL", undefined);
+  _dropped.clear();
+}
 
-  // If channel isn't connected yet, buffer the message and return.
-  if (_status != CONNECTED)
+void DuplexHandler::sendFailed(gId id)
+{
+  // While connected, the client only turns messages down when more than
+  // WEBSOCKETS_TX_QUEUE_SIZE bytes wait for the network. Instead of waiting, the sender gets to
+  // back off.
+  Callback cb;
+  if (_status == CONNECTED && _requests.take(id, &cb))
   {
-    _buffer.push(message.id, message.str);
-    return {message.id, message.str};
+    DEBUG_GRANDEUR("Send queue is full. Dropping message:: Id: %lu.", id);
+    cb("SEND-QUEUE-FULL", undefined);
   }
+}
 
-  // Sending message.
-  sendMessage(message.str.c_str());
+void DuplexHandler::sendPayload(gId id, const char *task, const Var &payload)
+{
+  // Batches and buffered messages have to fit in the send buffer, but a message going out on
+  // its own can be streamed instead of growing the buffer past FRAGMENT_SIZE. While one is
+  // streamed, the sender of another gets to back off.
+  bool streaming = _status == CONNECTED && !_batching && (!_flushing || _streamId != 0);
+  size_t length = prepareMessage(id, task, payload, streaming ? FRAGMENT_SIZE : MESSAGE_MAX_SIZE);
 
-  return {message.id, message.str};
+  if (length == 0 && streaming)
+    return _streamId != 0 ? sendFailed(id) : sendStreamed(id, task, payload);
+
+  sendPrepared(id, length);
 }
 
-Message DuplexHandler::send(const char *task)
+// Prints into the send buffer behind the room for the frame header and sends it as a fragment
+// whenever it fills up. Only the last fragment has fin set, so the message has to be ended with
+// end(). A fragment only goes out while less than a fragment's worth of bytes waits for the
+// network. Otherwise the writer pauses, and a later pass over the same message skips the bytes
+// sent before.
+class FragmentWriter : public Print
 {
-  // Preparing a new message.
-  Message message = prepareMessage(task);
+private:
+  WebSocketsClient &_client;
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _length;
+  // Bytes of the message left to skip, and bytes of it sent.
+  size_t _skip;
+  size_t _sent;
+  bool _paused;
+  bool _failed;
 
-  // If channel isn't connected yet, buffer the message and return.
-  if (_status != CONNECTED)
+  bool sendFragment(bool fin)
   {
-    _buffer.push(message.id, message.str);
-    return {message.id, message.str};
+    if (_failed || _paused)
+      return false;
+
+    if (_client.queuedBytes() >= _size)
+    {
+      _paused = true;
+      return false;
+    }
+
+    // The fragment is masked in place, which is fine as it's overwritten next.
+    WSopcode_t opcode = _sent == 0 ? WSop_text : WSop_continuation;
+    _failed = !_client.sendFragment(opcode, _buffer, _length, fin, true);
+    if (!_failed)
+      _sent += _length;
+    _length = 0;
+    return !_failed;
   }
 
-  // Sending message.
-  sendMessage(message.str.c_str());
+public:
+  FragmentWriter(WebSocketsClient &client, uint8_t *buffer, size_t size, size_t sent)
+      : _client(client), _buffer(buffer), _size(size - WEBSOCKETS_MAX_HEADER_SIZE), _length(0), _skip(sent),
+        _sent(sent), _paused(false), _failed(false) {}
+
+  size_t write(uint8_t c)
+  {
+    return write(&c, 1);
+  }
 
-  return {message.id, message.str};
+  size_t write(const uint8_t *data, size_t length)
+  {
+    // The rest of the pass is only run through once the writer stops.
+    if (_paused || _failed)
+      return length;
+
+    size_t written = _skip < length ? _skip : length;
+    _skip -= written;
+    while (written < length)
+    {
+      if (_length == _size && !sendFragment(false))
+        break;
+
+      size_t n = length - written;
+      if (n > _size - _length)
+        n = _size - _length;
+      memcpy(_buffer + WEBSOCKETS_MAX_HEADER_SIZE + _length, data + written, n);
+      _length += n;
+      written += n;
+    }
+    return length;
+  }
+
+  // Sends what's left as the last fragment, unless the writer stopped.
+  void end(void)
+  {
+    sendFragment(true);
+  }
+
+  // Bytes of the message sent, on this pass and the ones before.
+  size_t sent(void)
+  {
+    return _sent;
+  }
+
+  bool paused(void)
+  {
+    return _paused;
+  }
+
+  bool failed(void)
+  {
+    return _failed;
+  }
+};
+
+void DuplexHandler::sendStreamed(gId id, const char *task, const Var &payload)
+{
+  DEBUG_GRANDEUR("Streaming message:: Id: %lu, task: %s.", id, task);
+  _streamId = id;
+  _streamTask = task;
+  _streamSent = 0;
+  if (streamFragments(payload))
+    return;
+
+  // The rest goes out on loop, from a copy of the payload on the heap, and new messages are
+  // buffered behind it until then.
+  _streamPayload = payload;
+  if (_streamPayload.isUndefined() && !payload.isUndefined())
+  {
+    DEBUG_GRANDEUR("No memory left to keep the message:: Id: %lu.", id);
+    endStream(false);
+    return;
+  }
+  _flushing = true;
 }
 
-Message DuplexHandler::send(const char *task, Var payload, Callback cb)
+bool DuplexHandler::streamFragments(const Var &payload)
 {
-  // Preparing a new message.
-  Message message = prepareMessage(task, payload);
+  // Fragments take the whole send buffer. If it can't grow, smaller fragments do as well.
+  if (_sendBufferSize < FRAGMENT_SIZE)
+    growSendBuffer(FRAGMENT_SIZE - WEBSOCKETS_MAX_HEADER_SIZE, FRAGMENT_SIZE);
+  // The send buffer may have grown for a buffered message, fragments stay at FRAGMENT_SIZE.
+  size_t size = _sendBufferSize < FRAGMENT_SIZE ? _sendBufferSize : FRAGMENT_SIZE;
+  // Not running through the message while the network hasn't taken the last fragment yet.
+  if (_streamSent > 0 && queuedBytes() >= size - WEBSOCKETS_MAX_HEADER_SIZE)
+    return false;
 
-  // Adding task to receive the response message.
-  _tasks.once(message.id, cb);
+  _lastTraffic = millis();
+  FragmentWriter writer(_client, (uint8_t *)_sendBuffer, size, _streamSent);
+  writer.print("{\"header\":{\"id\":");
+  writer.print(_streamId);
+  writer.print(",\"task\":\"");
+  writer.print(_streamTask);
+  writer.print("\"},\"payload\":");
+  payload.stringifyTo(writer);
+  writer.print("}");
+  writer.end();
+  _streamSent = writer.sent();
+  if (writer.paused())
+    return false;
+
+  endStream(!writer.failed());
+  return true;
+}
+
+void DuplexHandler::endStream(bool sent)
+{
+  gId id = _streamId;
+  _streamId = 0;
+  _streamPayload = Var();
+  shrinkSendBuffer();
+  if (sent)
+    return;
 
-  // If channel isn't connected yet, buffer the message and return.
+  sendFailed(id);
+  // Grandeur can't take another message after one that's cut off, so the connection is dropped
+  // to start over. A message cut off by the connection dropping isn't resent.
+  if (_streamSent > 0)
+  {
+    DEBUG_GRANDEUR("Message cut off:: Id: %lu. Dropping the connection.", id);
+    _client.disconnect();
+  }
+}
+
+void DuplexHandler::flushBatch(void)
+{
+  if (_batchLength == 0)
+    return;
+
+  char *batch = _sendBuffer + WEBSOCKETS_MAX_HEADER_SIZE;
+  batch[_batchLength] = ']';
+  batch[_batchLength + 1] = '\0';
+
+  DEBUG_GRANDEUR("Sending batch:: %s.", batch);
+  _lastTraffic = millis();
+  bool sent = _client.sendTXT((uint8_t *)_sendBuffer, _batchLength + 1, true);
+  _batchLength = 0;
+  shrinkSendBuffer();
+  // The senders of what's batched back off together if the batch is turned down.
+  if (!sent)
+    for (size_t i = 0; i < _batchIds.size(); i++)
+      sendFailed(_batchIds[i]);
+  _batchIds.clear();
+}
+
+void DuplexHandler::flushBuffers(void)
+{
+  // Nothing can go out in the middle of a streamed message, so it's finished first.
+  if (_streamId != 0 && !streamFragments(_streamPayload))
+    return;
+
+  // Sending subscriptions first, and stopping once the send queue has no room left. The rest
+  // goes on a later loop, after the ones sent last.
+  bool flushed = true;
+  _subscriptionBuffer.forEach([&](gId id, const char *message)
+                              {
+                                if (id <= _flushedSubscription)
+                                  return true;
+                                if (queuedBytes() > WEBSOCKETS_TX_QUEUE_SIZE || !sendMessage(message))
+                                  return flushed = false;
+                                _flushedSubscription = id;
+                                return true;
+                              });
+  if (flushed)
+    _buffer.forEach([&](gId id, const char *message)
+                    {
+                      if (id <= _flushedMessage)
+                        return true;
+                      if (queuedBytes() > WEBSOCKETS_TX_QUEUE_SIZE || !sendMessage(message))
+                        return flushed = false;
+                      _flushedMessage = id;
+                      return true;
+                    });
+  _flushing = !flushed;
+}
+
+bool DuplexHandler::sendMessage(const char *message)
+{
+  // Returning if channel isn't alive.
   if (_status != CONNECTED)
+    return false;
+
+  _lastTraffic = millis();
+
+  DEBUG_GRANDEUR("Sending message:: %s.", message);
+  // Sending on channel.
+  return _client.sendTXT(message);
+}
+
+gId DuplexHandler::send(const char *task, Callback cb)
+{
+  // Adding task to receive the response message. The message isn't sent if there's no room.
+  gId id = _requests.add(cb, REQUEST_TIMEOUT);
+  if (id == 0)
   {
-    _buffer.push(message.id, message.str);
-    return {message.id, message.str};
+    DEBUG_GRANDEUR("Too many requests are waiting for a response.");
+    cb("TOO-MANY-REQUESTS", undefined);
+    return 0;
   }
 
+  // Preparing a new message.
+  size_t length = prepareMessage(id, task);
+
   // Sending message.
-  sendMessage(message.str.c_str());
+  sendPrepared(id, length);
 
-  return {message.id, message.str};
+  return id;
 }
 
-Message DuplexHandler::send(const char *task, Var payload)
+gId DuplexHandler::send(const char *task)
 {
   // Preparing a new message.
-  Message message = prepareMessage(task, payload);
+  gId id = _requests.nextId();
+  size_t length = prepareMessage(id, task);
 
-  // If channel isn't connected yet, buffer the message and return.
-  if (_status != CONNECTED)
+  // Sending message.
+  sendPrepared(id, length);
+
+  return id;
+}
+
+gId DuplexHandler::send(const char *task, const Var &payload, Callback cb)
+{
+  // Adding task to receive the response message. The message isn't sent if there's no room.
+  gId id = _requests.add(cb, REQUEST_TIMEOUT);
+  if (id == 0)
   {
-    _buffer.push(message.id, message.str);
-    return {message.id, message.str};
+    DEBUG_GRANDEUR("Too many requests are waiting for a response.");
+    cb("TOO-MANY-REQUESTS", undefined);
+    return 0;
   }
 
-  // Sending message.
-  sendMessage(message.str.c_str());
+  // Preparing and sending a new message.
+  sendPayload(id, task, payload);
+
+  return id;
+}
+
+gId DuplexHandler::send(const char *task, const Var &payload)
+{
+  // Preparing and sending a new message.
+  gId id = _requests.nextId();
+  sendPayload(id, task, payload);
+
+  return id;
+}
+
+void DuplexHandler::sendCoalesced(const char *task, const String &key, Var payload, Callback cb)
+{
+  if (!_coalescing)
+  {
+    send(task, std::move(payload), cb);
+    return;
+  }
+
+  Pending *pending = findPending(key);
+  // Sending what's pending if the window is full. The callbacks run while sending may coalesce
+  // new messages, so the key is looked for again. If they fill the window up again, this message
+  // goes out right away.
+  if (pending == NULL && _nPending == _pending.size())
+  {
+    flushPending();
+    pending = findPending(key);
+    if (pending == NULL && _nPending == _pending.size())
+    {
+      send(task, std::move(payload), cb);
+      return;
+    }
+  }
+
+  // Last write wins: a pending message with the same key takes the new payload and callback.
+  // The callback it had is told its message won't be sent.
+  if (pending != NULL)
+  {
+    Callback superseded = std::move(pending->cb);
+    pending->payload = std::move(payload);
+    pending->cb = cb;
+    superseded("COALESCED", undefined);
+    return;
+  }
+
+  if (_nPending == 0)
+    _coalesceStart = millis();
+
+  pending = &_pending[_nPending++];
+  pending->task = task;
+  pending->key = key;
+  pending->payload = std::move(payload);
+  pending->cb = cb;
+}
+
+DuplexHandler::Pending *DuplexHandler::findPending(const String &key)
+{
+  for (size_t i = 0; i < _nPending; i++)
+    if (_pending[i].key == key)
+      return &_pending[i];
+  return NULL;
+}
 
-  return {message.id, message.str};
+void DuplexHandler::flushPending(void)
+{
+  if (_nPending == 0)
+    return;
+
+  DEBUG_GRANDEUR("Sending %d coalesced messages.", _nPending);
+  // Taking the pending messages out before sending any, as the callbacks send() runs may
+  // coalesce new ones. They go into the spare entries, or new ones while those are in use.
+  std::vector<Pending> sending;
+  sending.swap(_pending);
+  _pending.swap(_sparePending);
+  _pending.resize(sending.size());
+  size_t nSending = _nPending;
+  _nPending = 0;
+
+  for (size_t i = 0; i < nSending; i++)
+  {
+    Pending &pending = sending[i];
+    if (!pending.cb)
+      send(pending.task, pending.payload);
+    else
+      send(pending.task, pending.payload, pending.cb);
+    // Freeing the payload now rather than when the entry is reused, a window later.
+    pending.payload = Var();
+    pending.cb = Callback();
+  }
+  // Keeping the entries for the next flush.
+  _sparePending.swap(sending);
 }
 
-void DuplexHandler::receive(Var header, Var payload)
+void DuplexHandler::receive(Var &header, Var &payload)
 {
   // Extracting task and id from header and code.
   const char *task = header["task"];
   gId id = header["id"];
   const char *code = payload["code"];
+  String codeCopy;
 
-  // Extracting data.
-  Var data = null;
+  // Extracting data. It's viewed in place, the message is thrown away after this anyway.
+  Var data;
   // Response to Get has data in payload["data"].
   if (strcmp(task, "/device/data/get") == 0)
     data = payload["data"];
   // Response to Set has data in payload["update"].
   else if (strcmp(task, "/device/data/set") == 0)
     data = payload["update"];
-  // For datastore, we delete code and message from the payload and send the rest.
+  // For datastore, we delete code and message from the payload and send the rest. The code is
+  // kept aside as deleting it frees its string.
   else if (strcmp(task, "/datastore/insert") == 0 || strcmp(task, "/datastore/delete") == 0 ||
            strcmp(task, "/datastore/update") == 0 || strcmp(task, "/datastore/pipeline") == 0)
   {
-    data = payload;
-    data["code"] = undefined;
-    data["message"] = undefined;
+    codeCopy = code;
+    code = codeCopy.c_str();
+    payload["code"] = undefined;
+    payload["message"] = undefined;
+    data = std::move(payload);
   }
 
   DEBUG_GRANDEUR("Response message:: code: %s, data: %s.", code, JSON.stringify(data).c_str());
 
-  // Emit on the Id from the tasks.
-  if (Var::typeof_(data) != "null" && Var::typeof_(data) != "undefined")
-    _tasks.emit(id, code, data);
+  // Run the callback of the request.
+  Callback cb;
+  if (!_requests.take(id, &cb))
+    return;
+  if (!data.isNull() && !data.isUndefined())
+    cb(code, data);
   else
-    _tasks.emit(id, code, undefined);
+    cb(code, undefined);
 }
 
-void DuplexHandler::publish(const char *event, const char *path, Var data)
+void DuplexHandler::publish(const char *event, const char *path, const Var &data)
 {
   DEBUG_GRANDEUR("Data update:: path: %s, data: %s.", path, JSON.stringify(data));
 
@@ -217,51 +887,65 @@ void DuplexHandler::publish(const char *event, const char *path, Var data)
   if (strcmp(event, "deviceParms") == 0 || strcmp(event, "deviceSummary") == 0)
     strcpy((char *)event, "data");
 
-  // If it's update for device data, emit on the pattern "event/path". So that the listeners
-  // subscribing to "event/"" get the update for "event/path" as well.
+  // Updates of device data go to the handlers of "event/path" and of every prefix of it, so the
+  // handlers subscribing to "event/" get the update for "event/path" as well.
   if (strcmp(event, "data") == 0)
   {
-    _subscriptions.pEmit(String(event) + "/" + String(path), path, data);
+    _subscriptions.dispatch(event, path, data);
     return;
   }
 
   // Otherwise just emit on the event.
-  _subscriptions.emit(String(event), "", data);
+  _subscriptions.dispatch(event, "", data);
   return;
 }
 
-gId DuplexHandler::subscribe(const char *topic, Var payload, Callback updateHandler)
+gId DuplexHandler::subscribe(const char *topic, const Var &payload, Callback updateHandler)
 {
   DEBUG_GRANDEUR("Subscribing to topic:: %s.", topic);
 
-  // Sending subscription request.
-  Message message = send("/topic/subscribe", payload);
-  // Setting update handler.
-  _subscriptions.on(String(topic), updateHandler);
+  // Preparing subscription request.
+  gId id = _requests.nextId();
+  size_t length = prepareMessage(id, "/topic/subscribe", payload);
   // Buffer subscription request message regardless of connection/disconnection to handle the case
   // of subscribing, disconnecting, and reconnecting without record of previous subscriptions.
-  _buffer.push(message.id, message.str);
+  // This has to happen before sending, which masks the message in place. A subscription that
+  // couldn't be renewed after a reconnect isn't made at all.
+  if (length == 0 || !_subscriptionBuffer.push(id, preparedMessage()))
+  {
+    DEBUG_GRANDEUR("Subscription buffer is full. Not subscribing to topic:: %s.", topic);
+    return 0;
+  }
+  // Sending subscription request from the buffer, behind the ones still being sent since
+  // connecting, and on later loops if the send queue is full.
+  if (_status == CONNECTED)
+  {
+    _flushing = true;
+    flushBuffers();
+  }
+  // Setting update handler.
+  _subscriptions.add(id, topic, updateHandler);
 
   // Return the message Id.
-  return message.id;
+  return id;
 }
 
-void DuplexHandler::unsubscribe(const char *topic, gId eventId, Var payload)
+void DuplexHandler::unsubscribe(const char *topic, gId eventId, const Var &payload)
 {
   DEBUG_GRANDEUR("Unsubscribing from topic:: %s.", JSON.stringify(payload).c_str());
 
   // Sending unsubscription request to Grandeur. and remove subscription request message from buffer for future reconnection.
   send("/topic/unsubscribe", payload);
   // Unset the update handler
-  _subscriptions.off(String(topic));
+  _subscriptions.remove(eventId);
   // Debuffer the subscription packet.
-  _buffer.remove(eventId);
+  _subscriptionBuffer.remove(eventId);
 }
 
 void DuplexHandler::duplexEventHandler(WStype_t eventType, uint8_t *message, size_t length)
 {
-  // Resetting timeSinceLastMessage.
-  // timeSinceLastMessage = millis();
+  // Anything coming in puts off the next ping.
+  _lastTraffic = millis();
   // Switch over event type
   switch (eventType)
   {
@@ -269,12 +953,14 @@ void DuplexHandler::duplexEventHandler(WStype_t eventType, uint8_t *message, siz
     DEBUG_GRANDEUR("Duplex channel established.");
     // When duplex connection opens
     _status = CONNECTED;
+    // Sending all buffered messages again, subscriptions first. What the connection handler
+    // sends is buffered behind them.
+    _flushing = true;
+    _flushedSubscription = 0;
+    _flushedMessage = 0;
     // Running connection handler.
     _connectionHandler(_status);
-
-    // Flushing all buffered messages to the channel.
-    _buffer.forEach([=](const char *message)
-                    { sendMessage(message); });
+    flushBuffers();
 
     break;
 
@@ -282,75 +968,709 @@ void DuplexHandler::duplexEventHandler(WStype_t eventType, uint8_t *message, siz
     DEBUG_GRANDEUR("Duplex channel broke.");
     // When duplex connection closes
     _status = DISCONNECTED;
+    _flushing = false;
+    // A message being streamed went down with the connection, and is answered below.
+    _streamId = 0;
+    _streamPayload = Var();
     // Running connection handler.
     _connectionHandler(_status);
 
-    // Clear all tasks.
-    _tasks.offAll();
+    // Answering the requests that went down with the connection. Those whose messages are
+    // buffered are sent again on reconnect and keep waiting, up to their deadlines. So do the
+    // requests their callbacks make, which are buffered as well.
+    {
+      gId id;
+      Callback cb;
+      while (_requests.takeIf([=](gId id)
+                              { return !_buffer.has(id); },
+                              &id, &cb))
+        cb("DISCONNECTED", undefined);
+    }
+    // The batch went down with the connection, and so did a message coming in fragments.
+    _batchLength = 0;
+    _batchIds.clear();
+    _receiving = false;
+    shrinkSendBuffer();
+    shrinkBuffer(&_receiveBuffer, &_receiveBufferSize, MESSAGE_SIZE);
 
     break;
 
   case WStype_TEXT:
     // When a duplex message is received.
-    DEBUG_GRANDEUR("Message is received:: %s.", message);
-    // Parsing the JSON message.
-    Var oMessage = JSON.parse((char *)message);
-    // Handling any parsing errors
-    if (JSON.typeof(oMessage) == "undefined")
+    handleMessage((char *)message);
+    break;
+
+  // Messages larger than a frame come in fragments. They are put back together and handled as
+  // one message once the last fragment is in.
+  case WStype_FRAGMENT_TEXT_START:
+    _receiveLength = 0;
+    _receiving = appendFragment(message, length);
+    break;
+
+  case WStype_FRAGMENT:
+    if (_receiving)
+      _receiving = appendFragment(message, length);
+    break;
+
+  case WStype_FRAGMENT_FIN:
+    if (_receiving && appendFragment(message, length))
+      handleMessage(_receiveBuffer);
+    _receiving = false;
+    // A large message is rare, so the room it took is given back.
+    shrinkBuffer(&_receiveBuffer, &_receiveBufferSize, MESSAGE_SIZE);
+    break;
+
+  default:
+    break;
+  }
+}
+
+void DuplexHandler::handleMessage(char *message)
+{
+  DEBUG_GRANDEUR("Message is received:: %s.", message);
+
+  // Routing on the header first, so that messages nobody waits for are never parsed.
+  const char *scannedTask = NULL;
+  size_t taskLength = 0;
+  gId id = 0;
+  if (scanHeader((const char *)message, &scannedTask, &taskLength, &id))
+  {
+    // We do not need to handle the unpair event in Device SDKs and ping has no data.
+    if (equals(scannedTask, taskLength, "unpair") || equals(scannedTask, taskLength, "ping"))
+      return;
+    // A response to a message without a pending task only has to leave the buffer.
+    if (!equals(scannedTask, taskLength, "update") && !_requests.has(id))
     {
-      // Just for internal errors of Arduino_JSON
-      // if the parsing fails.
-      DEBUG_GRANDEUR("Parsing message failed!");
+      _buffer.remove(id);
       return;
     }
+  }
+
+  // Parsing the JSON message in the arena. Only the parsing, so what callbacks allocate
+  // stays on the heap.
+  Var oMessage;
+  {
+    JSONArena::Scope scope(_arena);
+    oMessage = JSON.parse(message);
+  }
+  // Handling any parsing errors
+  if (oMessage.isUndefined())
+  {
+    // Just for internal errors of Arduino_JSON
+    // if the parsing fails.
+    DEBUG_GRANDEUR("Parsing message failed!");
+    return;
+  }
+
+  Var header = oMessage["header"];
+  Var payload = oMessage["payload"];
+  const char *task = header["task"];
+
+  // ROUTES:
+  // We do not need to handle the unpair event in Device SDKs.
+  if (strcmp(task, "unpair") == 0)
+    ;
+  // Ping has no data so we simply emit.
+  else if (strcmp(task, "ping") == 0)
+    ;
+  // If it is an update event rather than a task (response message).
+  else if (strcmp(task, "update") == 0)
+    publish(payload["event"], payload["path"], payload["update"]);
+  // Otherwise: It's a response message for a task. So we receive it.
+  else
+  {
+    receive(header, payload);
+
+    // Debuffer the message. Subscription requests stay in their own buffer to solve losing
+    // subscriptions due to reconnection.
+    _buffer.remove((gId)header["id"]);
+  }
+}
+
+bool DuplexHandler::appendFragment(const uint8_t *fragment, size_t length)
+{
+  // Leaving room for the terminator.
+  size_t needed = _receiveLength + length + 1;
+  if (needed > RECEIVE_MAX_SIZE)
+  {
+    DEBUG_GRANDEUR("Message doesn't fit in %d bytes. Dropping it.", RECEIVE_MAX_SIZE);
+    return false;
+  }
+
+  if (needed > _receiveBufferSize)
+  {
+    size_t size = _receiveBufferSize ? _receiveBufferSize : MESSAGE_SIZE;
+    while (size < needed)
+      size *= 2;
+    if (size > RECEIVE_MAX_SIZE)
+      size = RECEIVE_MAX_SIZE;
+
+    char *buffer = (char *)realloc(_receiveBuffer, size);
+    if (buffer == NULL)
+    {
+      DEBUG_GRANDEUR("No memory for a message of %u bytes. Dropping it.", (unsigned int)needed);
+      return false;
+    }
+    _receiveBuffer = buffer;
+    _receiveBufferSize = size;
+  }
+
+  memcpy(_receiveBuffer + _receiveLength, fragment, length);
+  _receiveLength += length;
+  _receiveBuffer[_receiveLength] = '\0';
+  return true;
+}
+
+Requests::Requests(size_t capacity) : _free(0), _count(0), _lastId(0)
+{
+  _slots = new Slot[capacity];
+  _heap = new size_t[capacity];
+  _capacity = capacity;
+  clear();
+}
+
+Requests::~Requests()
+{
+  delete[] _slots;
+  delete[] _heap;
+}
+
+gId Requests::nextId(void)
+{
+  // Id 0 means no request.
+  if (++_lastId == 0)
+    ++_lastId;
+  return _lastId;
+}
+
+gId Requests::add(Callback cb, unsigned long timeout)
+{
+  if (_free == _capacity)
+    return 0;
+
+  // Taking the first free slot and the next id that falls into it.
+  size_t slot = _free;
+  Slot &s = _slots[slot];
+  _free = s.link;
+  gId id = _lastId + 1;
+  id += (slot + _capacity - id % _capacity) % _capacity;
+  if (id == 0)
+    id += _capacity;
+  _lastId = id;
+
+  s.id = id;
+  s.cb = cb;
+  s.deadline = millis() + timeout;
+  s.link = _count;
+  _heap[_count++] = slot;
+  siftUp(s.link);
+
+  return id;
+}
+
+Requests::Slot *Requests::find(gId id)
+{
+  Slot &s = _slots[id % _capacity];
+  return id != 0 && s.id == id ? &s : NULL;
+}
+
+bool Requests::has(gId id)
+{
+  return find(id) != NULL;
+}
+
+bool Requests::take(gId id, Callback *cb)
+{
+  Slot *s = find(id);
+  if (s == NULL)
+    return false;
+
+  *cb = s->cb;
+  release(s - _slots);
+  return true;
+}
+
+void Requests::remove(gId id)
+{
+  Slot *s = find(id);
+  if (s != NULL)
+    release(s - _slots);
+}
+
+bool Requests::takeExpired(unsigned long now, gId *id, Callback *cb)
+{
+  // Comparing the difference keeps this right when millis() wraps around.
+  if (_count == 0 || (long)(now - _slots[_heap[0]].deadline) < 0)
+    return false;
+
+  Slot &s = _slots[_heap[0]];
+  *id = s.id;
+  *cb = s.cb;
+  release(_heap[0]);
+  return true;
+}
+
+bool Requests::takeIf(std::function<bool(gId)> match, gId *id, Callback *cb)
+{
+  for (size_t i = 0; i < _capacity; i++)
+  {
+    Slot &s = _slots[i];
+    if (s.id == 0 || !match(s.id))
+      continue;
+
+    *id = s.id;
+    *cb = s.cb;
+    release(i);
+    return true;
+  }
+  return false;
+}
+
+void Requests::clear(void)
+{
+  // Chaining all slots into the free list.
+  for (size_t i = 0; i < _capacity; i++)
+  {
+    _slots[i].id = 0;
+    _slots[i].cb = Callback();
+    _slots[i].link = i + 1;
+  }
+  _free = 0;
+  _count = 0;
+}
+
+void Requests::release(size_t slot)
+{
+  Slot &s = _slots[slot];
+  size_t position = s.link;
+
+  // Filling the hole in the heap with its last slot.
+  _count--;
+  if (position != _count)
+  {
+    size_t moved = _heap[_count];
+    _heap[position] = moved;
+    _slots[moved].link = position;
+    siftUp(position);
+    siftDown(_slots[moved].link);
+  }
+
+  s.id = 0;
+  s.cb = Callback();
+  s.link = _free;
+  _free = slot;
+}
+
+bool Requests::before(size_t a, size_t b)
+{
+  return (long)(_slots[_heap[a]].deadline - _slots[_heap[b]].deadline) < 0;
+}
+
+void Requests::swap(size_t a, size_t b)
+{
+  size_t slot = _heap[a];
+  _heap[a] = _heap[b];
+  _heap[b] = slot;
+  _slots[_heap[a]].link = a;
+  _slots[_heap[b]].link = b;
+}
+
+void Requests::siftUp(size_t position)
+{
+  while (position > 0 && before(position, (position - 1) / 2))
+  {
+    swap(position, (position - 1) / 2);
+    position = (position - 1) / 2;
+  }
+}
+
+void Requests::siftDown(size_t position)
+{
+  while (true)
+  {
+    size_t first = position;
+    size_t left = 2 * position + 1;
+    size_t right = left + 1;
+    if (left < _count && before(left, first))
+      first = left;
+    if (right < _count && before(right, first))
+      first = right;
+    if (first == position)
+      return;
+
+    swap(position, first);
+    position = first;
+  }
+}
+
+Subscriptions::Subscriptions() : _freeNode(NONE), _freeHandler(NONE), _dispatching(false), _removed(false)
+{
+  // The root stands for the empty topic.
+  _nodes.push_back({"", NONE, NONE, NONE, NONE});
+}
+
+// Length of the segment at the start of a topic, up to the next separator.
+static size_t segmentLength(const char *topic)
+{
+  return strcspn(topic, "/.");
+}
+
+size_t Subscriptions::find(size_t node, const char *segment, size_t length)
+{
+  for (size_t i = _nodes[node].child; i != NONE; i = _nodes[i].sibling)
+  {
+    const String &s = _nodes[i].segment;
+    if (s.length() == length && strncmp(s.c_str(), segment, length) == 0)
+      return i;
+  }
+  return NONE;
+}
+
+size_t Subscriptions::child(size_t node, const char *segment, size_t length)
+{
+  size_t i = find(node, segment, length);
+  if (i != NONE)
+    return i;
+
+  // Reusing a freed node if there's one.
+  if (_freeNode != NONE)
+  {
+    i = _freeNode;
+    _freeNode = _nodes[i].sibling;
+  }
+  else
+  {
+    i = _nodes.size();
+    _nodes.push_back({"", NONE, NONE, NONE, NONE});
+  }
+  Node &n = _nodes[i];
+  n.segment = String(segment).substring(0, length);
+  n.parent = node;
+  n.child = NONE;
+  n.handlers = NONE;
+  n.sibling = _nodes[node].child;
+  _nodes[node].child = i;
+  return i;
+}
+
+void Subscriptions::add(gId id, const char *topic, Callback cb)
+{
+  size_t node = 0;
+  for (const char *s = topic; *s;)
+  {
+    size_t length = segmentLength(s);
+    if (length > 0)
+      node = child(node, s, length);
+    s += length;
+    if (*s)
+      s++;
+  }
+
+  size_t i;
+  if (_freeHandler != NONE)
+  {
+    i = _freeHandler;
+    _freeHandler = _handlers[i].next;
+  }
+  else
+  {
+    i = _handlers.size();
+    _handlers.push_back({0, Callback(), NONE, NONE});
+  }
+  _handlers[i] = {id, cb, node, NONE};
 
-    Var header = oMessage["header"];
-    Var payload = oMessage["payload"];
-    const char *task = header["task"];
-
-    // ROUTES:
-    // We do not need to handle the unpair event in Device SDKs.
-    if (strcmp(task, "unpair") == 0)
-      ;
-    // Ping has no data so we simply emit.
-    else if (strcmp(task, "ping") == 0)
-      ;
-    // If it is an update event rather than a task (response message).
-    else if (strcmp(task, "update") == 0)
-      publish(payload["event"], payload["path"], payload["update"]);
-    // Otherwise: It's a response message for a task. So we receive it.
+  // Appending it to the handlers of the node, to call them in the order they were added.
+  size_t *link = &_nodes[node].handlers;
+  while (*link != NONE)
+    link = &_handlers[*link].next;
+  *link = i;
+}
+
+void Subscriptions::remove(gId id)
+{
+  if (id == 0)
+    return;
+  for (size_t i = 0; i < _handlers.size(); i++)
+  {
+    if (_handlers[i].id != id || _handlers[i].node == NONE)
+      continue;
+    // Dispatching may be walking this handler's list.
+    if (_dispatching)
+    {
+      _handlers[i].id = 0;
+      _removed = true;
+    }
     else
+      unlink(i);
+    return;
+  }
+}
+
+void Subscriptions::unlink(size_t handler)
+{
+  size_t node = _handlers[handler].node;
+  size_t *link = &_nodes[node].handlers;
+  while (*link != handler)
+    link = &_handlers[*link].next;
+  *link = _handlers[handler].next;
+
+  _handlers[handler].id = 0;
+  _handlers[handler].cb = Callback();
+  _handlers[handler].node = NONE;
+  _handlers[handler].next = _freeHandler;
+  _freeHandler = handler;
+
+  // Freeing the nodes this leaves empty, up to the root.
+  while (node != 0 && _nodes[node].handlers == NONE && _nodes[node].child == NONE)
+  {
+    size_t parent = _nodes[node].parent;
+    size_t *sibling = &_nodes[parent].child;
+    while (*sibling != node)
+      sibling = &_nodes[*sibling].sibling;
+    *sibling = _nodes[node].sibling;
+
+    _nodes[node].sibling = _freeNode;
+    _freeNode = node;
+    node = parent;
+  }
+}
+
+void Subscriptions::dispatch(const char *event, const char *path, const Var &data)
+{
+  _dispatching = true;
+  size_t node = 0;
+  const char *topic[2] = {event, path};
+  for (int t = 0; t < 2 && node != NONE; t++)
+  {
+    for (const char *s = topic[t]; *s && node != NONE;)
     {
-      receive(header, payload);
-
-      // Debuffer the message except if it's a subscription request. This is to solve losing
-      // subscriptions due to reconnection.
-      if (strcmp(task, "/topic/subscribe") == 0)
-        ;
-      else
-        _buffer.remove((gId)header["id"]);
+      size_t length = segmentLength(s);
+      if (length > 0)
+      {
+        node = find(node, s, length);
+        if (node == NONE)
+          break;
+        for (size_t i = _nodes[node].handlers; i != NONE; i = _handlers[i].next)
+        {
+          if (_handlers[i].id != 0)
+            _handlers[i].cb(path, data);
+        }
+      }
+      s += length;
+      if (*s)
+        s++;
     }
   }
+  _dispatching = false;
+
+  // Unlinking the handlers removed while dispatching.
+  if (_removed)
+  {
+    _removed = false;
+    for (size_t i = 0; i < _handlers.size(); i++)
+      if (_handlers[i].id == 0 && _handlers[i].node != NONE)
+        unlink(i);
+  }
+}
+
+// Records are padded to keep their headers aligned.
+static size_t recordSize(size_t length)
+{
+  const size_t align = alignof(uint16_t);
+  return (sizeof(uint16_t) * 2 + length + align - 1) & ~(align - 1);
+}
+
+Buffer::Buffer(size_t size, size_t nMessages, BufferOverflow overflow, size_t maxSize, size_t maxMessages)
+    : _head(0), _tail(0), _used(0), _count(0), _overflow(overflow), _dropHandler([](gId id) {})
+{
+  // Offsets and sizes are 16 bits.
+  _size = size < NO_ENTRY ? size : NO_ENTRY;
+  _nEntries = nMessages < NO_ENTRY ? nMessages : NO_ENTRY - 1;
+  _maxSize = maxSize < _size ? _size : (maxSize < NO_ENTRY ? maxSize : NO_ENTRY);
+  _maxEntries = maxMessages < _nEntries ? _nEntries : (maxMessages < NO_ENTRY ? maxMessages : NO_ENTRY - 1);
+  _arena = (uint8_t *)malloc(_size);
+  _index = (Entry *)malloc(_nEntries * sizeof(Entry));
+  if (_arena == NULL || _index == NULL)
+    _size = _nEntries = 0;
+}
+
+Buffer::~Buffer()
+{
+  free(_arena);
+  free(_index);
+}
+
+Buffer::Record *Buffer::record(size_t offset)
+{
+  return (Record *)(_arena + offset);
+}
+
+bool Buffer::push(gId id, const char *message)
+{
+  // A message with the same id replaces the old one.
+  remove(id);
+
+  size_t length = strlen(message) + 1;
+  size_t size = recordSize(length);
+  if (size > _maxSize || _maxEntries == 0)
+    return false;
+
+  while (_tail + size > _size || _count == _nEntries)
+  {
+    // Sliding the records back if that makes room.
+    if (_count < _nEntries && _used + size <= _size)
+    {
+      compact();
+      continue;
+    }
+    if (grow(size))
+      continue;
+    if (_overflow != BUFFER_DROP_OLDEST)
+      return false;
+
+    gId dropped = _index[record(_head)->entry].id;
+    DEBUG_GRANDEUR("Buffer is full. Dropping message:: Id: %lu.", dropped);
+    pop();
+    _dropHandler(dropped);
+  }
+
+  Record *r = record(_tail);
+  r->size = size;
+  r->entry = _count;
+  memcpy(r + 1, message, length);
+  _index[_count++] = {id, (uint16_t)_tail};
+  _tail += size;
+  _used += size;
+  return true;
 }
 
-void Buffer::push(gId id, String message)
+void Buffer::pop(void)
 {
-  _buffer[id] = message;
+  if (_count == 0)
+    return;
+
+  // trim() keeps the record at _head a live one.
+  unlink(record(_head));
+  trim();
 }
 
 void Buffer::remove(gId id)
 {
-  _buffer.erase(id);
+  for (size_t i = 0; i < _count; i++)
+  {
+    if (_index[i].id != id)
+      continue;
+
+    unlink(record(_index[i].offset));
+    trim();
+    return;
+  }
 }
 
-void Buffer::forEach(std::function<void(const char *)> callback)
+bool Buffer::has(gId id)
 {
-  // Iterating through the _buffer running callback on each message.
-  for (std::map<gId, String>::iterator it = _buffer.begin(); it != _buffer.end(); it++)
+  for (size_t i = 0; i < _count; i++)
+    if (_index[i].id == id)
+      return true;
+  return false;
+}
+
+void Buffer::unlink(Record *r)
+{
+  // Filling the hole in the index with its last entry.
+  Entry &last = _index[--_count];
+  _index[r->entry] = last;
+  record(last.offset)->entry = r->entry;
+
+  r->entry = NO_ENTRY;
+  _used -= r->size;
+}
+
+void Buffer::trim(void)
+{
+  while (_head < _tail && record(_head)->entry == NO_ENTRY)
+    _head += record(_head)->size;
+
+  // An empty buffer starts over from the front.
+  if (_head == _tail)
+    _head = _tail = 0;
+}
+
+void Buffer::compact(void)
+{
+  size_t to = 0;
+  for (size_t from = _head; from < _tail;)
+  {
+    Record *r = record(from);
+    size_t size = r->size;
+    if (r->entry != NO_ENTRY)
+    {
+      _index[r->entry].offset = to;
+      // Records only move towards the front, so they never overwrite one that's still to come.
+      memmove(_arena + to, r, size);
+      to += size;
+    }
+    from += size;
+  }
+
+  _head = 0;
+  _tail = to;
+}
+
+bool Buffer::grow(size_t size)
+{
+  size_t arenaSize = _size;
+  while (arenaSize < _used + size && arenaSize < _maxSize)
+    arenaSize = arenaSize * 2 < _maxSize ? (arenaSize ? arenaSize * 2 : size) : _maxSize;
+  size_t nEntries = _nEntries;
+  if (_count == nEntries)
+    nEntries = nEntries * 2 < _maxEntries ? (nEntries ? nEntries * 2 : 1) : _maxEntries;
+  if (arenaSize < _used + size || _count == nEntries)
+    return false;
+
+  // Records are located by offset, so moving the arena leaves them valid. A failed realloc keeps
+  // what was there.
+  if (arenaSize != _size)
+  {
+    uint8_t *arena = (uint8_t *)realloc(_arena, arenaSize);
+    if (arena == NULL)
+      return false;
+    _arena = arena;
+    _size = arenaSize;
+  }
+  if (nEntries != _nEntries)
   {
-    DEBUG_GRANDEUR("Flushing:: Id: %lu, Message: %s.", it->first, it->second.c_str());
-    callback(it->second.c_str());
+    Entry *index = (Entry *)realloc(_index, nEntries * sizeof(Entry));
+    if (index == NULL)
+      return false;
+    _index = index;
+    _nEntries = nEntries;
   }
+  return true;
+}
+
+void Buffer::forEach(std::function<bool(gId, const char *)> callback)
+{
+  // Iterating through the arena running callback on each live message.
+  for (size_t offset = _head; offset < _tail; offset += record(offset)->size)
+  {
+    Record *r = record(offset);
+    if (r->entry == NO_ENTRY)
+      continue;
+
+    if (!callback(_index[r->entry].id, (const char *)(r + 1)))
+      return;
+  }
+}
+
+void Buffer::onDrop(std::function<void(gId)> dropHandler)
+{
+  _dropHandler = dropHandler;
+}
+
+BufferOverflow Buffer::overflow(void)
+{
+  return _overflow;
 }
 
 void DuplexHandler::onConnectionEvent(void connectionCallback(bool))
@@ -359,6 +1679,11 @@ void DuplexHandler::onConnectionEvent(void connectionCallback(bool))
   _connectionHandler = connectionCallback;
 }
 
+void DuplexHandler::onConnectionAttempt(void attemptCallback(bool, unsigned long, unsigned long))
+{
+  _attemptHandler = attemptCallback;
+}
+
 void DuplexHandler::clearConnectionCallback(void)
 {
   DEBUG_GRANDEUR("Clearing connection handler.");
@@ -366,7 +1691,62 @@ void DuplexHandler::clearConnectionCallback(void)
   _connectionHandler = [](bool status) {};
 }
 
+size_t DuplexHandler::queuedBytes(void)
+{
+  return _client.queuedBytes();
+}
+
 bool DuplexHandler::getStatus()
 {
   return _status;
 }
+
+void DuplexHandler::enableBatching(unsigned long window)
+{
+  DEBUG_GRANDEUR("Batching messages sent within %lu ms.", window);
+  _batching = true;
+  _batchWindow = window;
+}
+
+void DuplexHandler::disableBatching(void)
+{
+  DEBUG_GRANDEUR("Sending messages one by one.");
+  flushBatch();
+  _batching = false;
+}
+
+void DuplexHandler::enableCoalescing(unsigned long window, size_t limit)
+{
+  DEBUG_GRANDEUR("Coalescing messages within %lu ms, up to %d of them.", window, limit);
+  flushPending();
+  _pending.resize(limit > 0 ? limit : 1);
+  _coalescing = true;
+  _coalesceWindow = window;
+}
+
+void DuplexHandler::disableCoalescing(void)
+{
+  DEBUG_GRANDEUR("Stopping coalescing.");
+  flushPending();
+  _pending.clear();
+  _sparePending.clear();
+  _coalescing = false;
+}
+
+bool DuplexHandler::isCoalescing(void)
+{
+  return _coalescing;
+}
+
+void DuplexHandler::setKeepalive(unsigned long interval, bool heartbeat)
+{
+  DEBUG_GRANDEUR("Pinging after %lu ms without traffic%s.", interval, heartbeat ? " with websocket pings" : "");
+  _keepalive = interval;
+  _heartbeat = heartbeat && interval > 0;
+  // Every ping restarts the wait for a pong, so a pong can only be missed before the next ping.
+  unsigned long timeout = PONG_TIMEOUT < interval / 2 ? PONG_TIMEOUT : interval / 2;
+  if (_heartbeat)
+    _client.enableHeartbeat(interval, timeout, PONG_MISSES);
+  else
+    _client.disableHeartbeat();
+}
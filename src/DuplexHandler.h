@@ -11,24 +11,195 @@
 // Including headers
 #include "types.h"
 #include "macros.h"
-#include "EventEmitter/EventEmitter.h"
 #include "arduinoWebSockets/WebSocketsClient.h"
-#include <map>
+#include <deque>
+#include <functional>
+#include <vector>
 
 #ifndef DUPLEXHANDLER_H_
 #define DUPLEXHANDLER_H_
 
+// What Buffer does with a message it has no room for.
+enum BufferOverflow {
+  // Drops the oldest messages until the new one fits.
+  BUFFER_DROP_OLDEST,
+  // Drops the new message.
+  BUFFER_DROP_NEWEST,
+  // Drops the new message, the same as BUFFER_DROP_NEWEST.
+  BUFFER_REJECT
+};
+
+// Buffering of messages when duplex channel isn't alive, in an arena that's allocated once.
+// Messages are stored behind each other as records of their size, their position in the index
+// and their text, and are popped from the front. Once the back of the arena is reached, the
+// records slide back to its start, which also reclaims records removed out of order.
 class Buffer {
   private:
-    // We use map to implement buffering of messages when duplex channel isn't alive.
-    std::map<gId, String> _buffer;
+    struct Record {
+      // Size of the whole record, padding included.
+      uint16_t size;
+      // Position in the index, NO_ENTRY once removed.
+      uint16_t entry;
+    };
+    // Locates a record by message id.
+    struct Entry {
+      gId id;
+      uint16_t offset;
+    };
+    static const uint16_t NO_ENTRY = 0xFFFF;
+
+    uint8_t* _arena;
+    size_t _size;
+    // The arena and the index may grow up to these.
+    size_t _maxSize;
+    size_t _maxEntries;
+    // Records live between _head and _tail and take _used bytes of it.
+    size_t _head;
+    size_t _tail;
+    size_t _used;
+    // One entry per live record.
+    Entry* _index;
+    size_t _nEntries;
+    size_t _count;
+    BufferOverflow _overflow;
+    // Gets the id of every message dropped to make room.
+    std::function<void(gId)> _dropHandler;
+
+    Record* record(size_t offset);
+    // Marks a record removed and takes it out of the index.
+    void unlink(Record* record);
+    // Moves _head past the removed records at the front.
+    void trim(void);
+    // Slides the live records back to the start of the arena.
+    void compact(void);
+    // Grows the arena and the index so that a record of size fits. Returns false if they can't.
+    bool grow(size_t size);
+
   public:
-    // Adds a message to the buffer with id.
-    void push(gId id, String message);
+    // The buffer starts out with room for size bytes and nMessages messages. Given larger
+    // maxSize and maxMessages, it grows up to them before overflowing.
+    Buffer(size_t size, size_t nMessages, BufferOverflow overflow, size_t maxSize = 0, size_t maxMessages = 0);
+    ~Buffer();
+    // Adds a message to the buffer with id. Returns false if there's no room for it.
+    bool push(gId id, const char* message);
+    // Removes the oldest message.
+    void pop(void);
     // Removes a message from the buffer with id.
     void remove(gId id);
-    // Calls a callback on each message in the buffer.
-    void forEach(std::function<void(const char*)> callback);
+    // Checks if a message with id is in the buffer.
+    bool has(gId id);
+    // Calls a callback with each message in the buffer and its id, oldest first, until it
+    // returns false.
+    void forEach(std::function<bool(gId, const char*)> callback);
+    // Sets a handler for messages dropped to make room for newer ones.
+    void onDrop(std::function<void(gId)> dropHandler);
+    BufferOverflow overflow(void);
+};
+
+// Table of requests waiting for their responses. A request's id encodes its slot, so finding
+// it takes no search, and a min-heap of the slots orders them by deadline.
+class Requests {
+  private:
+    struct Slot {
+      // Id of the request in the slot, 0 when it's free.
+      gId id;
+      Callback cb;
+      unsigned long deadline;
+      // Position in the heap when taken, next free slot when free.
+      size_t link;
+    };
+
+    Slot* _slots;
+    size_t _capacity;
+    size_t _free;
+    // Slot numbers ordered by deadline.
+    size_t* _heap;
+    size_t _count;
+    gId _lastId;
+
+    // Finds the slot of a pending request, or returns NULL.
+    Slot* find(gId id);
+    // Frees a slot and takes it out of the heap.
+    void release(size_t slot);
+    // Restore the heap order around a position.
+    void siftUp(size_t position);
+    void siftDown(size_t position);
+    void swap(size_t a, size_t b);
+    bool before(size_t a, size_t b);
+
+  public:
+    Requests(size_t capacity);
+    ~Requests();
+    // Returns a new id for a message that doesn't wait for a response.
+    gId nextId(void);
+    // Adds a request due in timeout milliseconds and returns its id, 0 if the table is full.
+    gId add(Callback cb, unsigned long timeout);
+    // Checks if a request is pending.
+    bool has(gId id);
+    // Removes a request, handing out its callback. Returns false if it isn't pending.
+    bool take(gId id, Callback* cb);
+    // Removes a request.
+    void remove(gId id);
+    // Removes the request with the earliest deadline if it's past now, handing out its id and
+    // callback. Returns false if there's none.
+    bool takeExpired(unsigned long now, gId* id, Callback* cb);
+    // Removes a request match returns true for, handing out its id and callback. Returns false if
+    // there's none.
+    bool takeIf(std::function<bool(gId)> match, gId* id, Callback* cb);
+    // Removes all requests.
+    void clear(void);
+};
+
+// Update handlers of topics like "data/voltage" or "data/a.b", kept in a trie of the topic's
+// segments. An update goes to the handlers of every node along its path, so a handler gets the
+// updates of its own path and of the paths nested under it. Dispatching doesn't allocate.
+class Subscriptions {
+  private:
+    struct Node {
+      // Segment of the topic between '/' or '.' separators.
+      String segment;
+      size_t parent;
+      // First child, next child of the parent, and first handler of the node.
+      size_t child;
+      size_t sibling;
+      size_t handlers;
+    };
+    struct Handler {
+      // Id of the subscription, 0 when the slot is free or the handler is removed.
+      gId id;
+      Callback cb;
+      // Node of the handler, NONE when the slot is free.
+      size_t node;
+      // Next handler of the node when taken, next free slot when free.
+      size_t next;
+    };
+
+    std::vector<Node> _nodes;
+    // Handlers may subscribe while they're called, which mustn't move the others.
+    std::deque<Handler> _handlers;
+    size_t _freeNode;
+    size_t _freeHandler;
+    // Handlers removed while dispatching are only unlinked once it's done.
+    bool _dispatching;
+    bool _removed;
+
+    // Finds the child of a node with a segment, or returns NONE.
+    size_t find(size_t node, const char* segment, size_t length);
+    // Finds the child of a node with a segment, creating it if there's none.
+    size_t child(size_t node, const char* segment, size_t length);
+    // Takes a handler out of its node and frees the node if nothing is left under it.
+    void unlink(size_t handler);
+
+  public:
+    static const size_t NONE = (size_t)-1;
+
+    Subscriptions();
+    // Adds a handler for a topic.
+    void add(gId id, const char* topic, Callback cb);
+    // Removes the handler of a subscription.
+    void remove(gId id);
+    // Calls the handlers of event and of every prefix of path with path and data.
+    void dispatch(const char* event, const char* path, const Var& data);
 };
 
 // Class to establish and handle real-time communication channel with Grandeur and send/receive
@@ -46,56 +217,189 @@ class DuplexHandler {
     // Points to the connection handler function to call when connection with Grandeur is successfully
     // estbalished.
     void (*_connectionHandler)(bool);
+    // Gets told how long each connection attempt took.
+    void (*_attemptHandler)(bool, unsigned long, unsigned long);
     // Handles request/response like communication.
-    EventEmitter<gId, Callback> _tasks;
+    Requests _requests;
     // List of subscribable events.
     const char* _events[1] = {"data"};
     // Handles pub/sub like communication.
-    EventEmitter<String, Callback> _subscriptions;
+    Subscriptions _subscriptions;
+    // Messages are parsed and payloads built in here. Declared ahead of the members holding
+    // payloads, so that it outlives them.
+    JSONArena _arena;
     
     
+    // Messages are serialized in here behind WEBSOCKETS_MAX_HEADER_SIZE bytes of room, into which
+    // the websockets client writes the frame header instead of copying the message.
+    char* _sendBuffer;
+    size_t _sendBufferSize;
+    // With batching on, messages pile up in the send buffer as a JSON array and go out in one
+    // frame once the oldest of them is _batchWindow milliseconds old.
+    bool _batching;
+    unsigned long _batchWindow;
+    unsigned long _batchStart;
+    // Length of the array in the send buffer, without its closing bracket.
+    size_t _batchLength;
+    // Ids of the messages in the batch, told if it can't be sent.
+    std::vector<gId> _batchIds;
+    // Ids of the messages the buffer dropped, whose senders are yet to be told.
+    std::vector<gId> _dropped;
+    // Messages that come in fragments are put back together in here. It's shrunk back to
+    // MESSAGE_SIZE after each of them.
+    char* _receiveBuffer;
+    size_t _receiveBufferSize;
+    size_t _receiveLength;
+    // Tells whether a fragmented message is being received, and not dropped.
+    bool _receiving;
+    // Messages held back by sendCoalesced(). Entries are reused from one window to the next.
+    struct Pending {
+      const char* task;
+      String key;
+      Var payload;
+      Callback cb;
+    };
+    std::vector<Pending> _pending;
+    // Entries the pending messages are swapped with while they are sent.
+    std::vector<Pending> _sparePending;
+    size_t _nPending;
+    bool _coalescing;
+    unsigned long _coalesceWindow;
+    unsigned long _coalesceStart;
+    // Grandeur is pinged once nothing has been sent or received for _keepalive milliseconds,
+    // with websocket ping frames instead of ping messages when _heartbeat is set.
+    unsigned long _keepalive;
+    bool _heartbeat;
+    unsigned long _lastTraffic;
+    // After connecting, the buffers are sent as fast as the send queue drains, over as many loops
+    // as that takes, and so is the rest of a streamed message. Until then, new messages are
+    // buffered behind them. These are the ids of the last subscription and message sent.
+    bool _flushing;
+    gId _flushedSubscription;
+    gId _flushedMessage;
+    // Message streamed in fragments, 0 when there's none, and the bytes of it sent so far. Its
+    // task has to outlive it. Its payload is only copied when it has to wait for the network.
+    gId _streamId;
+    const char* _streamTask;
+    Var _streamPayload;
+    size_t _streamSent;
+
     void duplexEventHandler(WStype_t eventType, uint8_t* packet, size_t length);
-    // Prepares a message.
-    Message prepareMessage(const char* task);
-    Message prepareMessage(const char* task, Var payload);
-    // Sends a generic duplex message.
-    void sendMessage(const char* message);
+    // Handles a whole message, whether it came in one frame or in fragments.
+    void handleMessage(char* message);
+    // Adds a fragment to the message in the receive buffer. Returns false if it doesn't fit in
+    // RECEIVE_MAX_SIZE.
+    bool appendFragment(const uint8_t* fragment, size_t length);
+    // Prepares a message in the send buffer and returns its length, 0 if it doesn't fit in
+    // limit bytes.
+    size_t prepareMessage(gId id, const char* task);
+    size_t prepareMessage(gId id, const char* task, const Var& payload, size_t limit = MESSAGE_MAX_SIZE);
+    // Doubles the send buffer, or grows it to fit a message of room bytes, up to limit.
+    bool growSendBuffer(size_t room = 0, size_t limit = MESSAGE_MAX_SIZE);
+    // Shrinks the send buffer back to MESSAGE_SIZE, or BATCH_SIZE if batching, once it's empty.
+    void shrinkSendBuffer(void);
+    // Makes room for a message of room bytes, if known, by flushing the batch or growing the send
+    // buffer up to limit.
+    bool makeRoom(size_t room = 0, size_t limit = MESSAGE_MAX_SIZE);
+    // Points to the message prepared in the send buffer.
+    char* preparedMessage(void);
+    // Space left for the next message in the send buffer.
+    size_t sendRoom(void);
+    // Sends the prepared message, adds it to the batch, or buffers it if channel isn't alive.
+    void sendPrepared(gId id, size_t length);
+    // Lets the senders of the messages dropped from the buffer know.
+    void answerDropped(void);
+    // Lets the sender of a message the websockets client didn't take know.
+    void sendFailed(gId id);
+    // Sends a message with payload, in fragments of the send buffer if it doesn't fit in
+    // FRAGMENT_SIZE.
+    void sendPayload(gId id, const char* task, const Var& payload);
+    // Prints a message straight into frames of the send buffer, as many as the network takes.
+    // The rest are sent on loop.
+    void sendStreamed(gId id, const char* task, const Var& payload);
+    // Sends the next fragments of the streamed message. Returns false if it isn't done yet.
+    bool streamFragments(const Var& payload);
+    // Forgets the streamed message, letting its sender know if it wasn't sent.
+    void endStream(bool sent);
+    // Sends the batched messages in one frame.
+    void flushBatch(void);
+    // Sends the messages held back for coalescing.
+    void flushPending(void);
+    // Finds the message held back for coalescing with key, or returns NULL.
+    Pending* findPending(const String& key);
+    // Sends the rest of the streamed message, then the buffered subscriptions and messages the
+    // websockets client takes, and the rest on later loops.
+    void flushBuffers(void);
+    // Sends a generic duplex message. Returns false if it isn't sent.
+    bool sendMessage(const char* message);
     // Receives a message from duplex channel.
-    void receive(Var header, Var payload);
+    void receive(Var& header, Var& payload);
     // Handles the update packet.
-    void publish(const char* event, const char* path, Var data);
+    void publish(const char* event, const char* path, const Var& data);
 
     // Buffering data structure:
     Buffer _buffer;
+    // Subscription requests, kept to subscribe again after reconnecting.
+    Buffer _subscriptionBuffer;
 
   public:
     // Constructor
     DuplexHandler();
+    ~DuplexHandler();
     void init(Config config);
-    // Sends a message to duplex channel:
+    // Arena to build payloads of outgoing messages in.
+    JSONArena& arena(void);
+    // Sends a message to duplex channel and returns its id:
     // without payload.
-    Message send(const char* task, Callback cb);
+    gId send(const char* task, Callback cb);
     // without payload, without response.
-    Message send(const char* task);
+    gId send(const char* task);
     // with payload.
-    Message send(const char* task, Var payload, Callback cb);
+    gId send(const char* task, const Var& payload, Callback cb);
     // with payload, without response.
-    Message send(const char* task, Var payload);
+    gId send(const char* task, const Var& payload);
+    // Sends a message, or holds it back in place of the pending one with the same key when
+    // coalescing. Task has to outlive the window.
+    void sendCoalesced(const char* task, const String& key, Var payload, Callback cb);
 
-    // Subscribes to a topic.
-    gId subscribe(const char* topic, Var payload, Callback updateHandler);
+    // Subscribes to a topic. Returns 0 without subscribing if there's no room left to keep the
+    // subscription for reconnects.
+    gId subscribe(const char* topic, const Var& payload, Callback updateHandler);
     // Unsubscribes from a topic.
-    void unsubscribe(const char* topic, gId eventId, Var payload);
+    void unsubscribe(const char* topic, gId eventId, const Var& payload);
 
 
     // Schedules a connection handler function to be called when connection with Grandeur
     // establishes/drops.
     void onConnectionEvent(void connectionCallback(bool));
+    // Schedules a function to be called after every connection attempt with whether it succeeded,
+    // and the milliseconds the TCP connect and the websocket handshake took.
+    void onConnectionAttempt(void attemptCallback(bool, unsigned long, unsigned long));
     // Removes the connection handler function.
     void clearConnectionCallback(void);
     
     // Gets current status (CONNECTED / DISCONNECTED) of the connection.
     bool getStatus(void);
+    // Bytes sent that the network hasn't taken yet.
+    size_t queuedBytes(void);
+
+    // Sends messages in batches of whatever is sent within window milliseconds, or within a loop
+    // when window is 0. Grandeur has to accept an array of messages in a frame for this.
+    void enableBatching(unsigned long window);
+    // Sends what's batched and goes back to a frame per message.
+    void disableBatching(void);
+
+    // Holds messages sent through sendCoalesced() back for window milliseconds, keeping only the
+    // last one of each key. They are sent on loop, or once limit keys are pending.
+    void enableCoalescing(unsigned long window, size_t limit);
+    // Sends what's held back and stops coalescing.
+    void disableCoalescing(void);
+    bool isCoalescing(void);
+
+    // Pings Grandeur once nothing has been sent or received for interval milliseconds, never when
+    // it's 0. With heartbeat, the pings are websocket ping frames and missing PONG_MISSES pongs
+    // drops the connection.
+    void setKeepalive(unsigned long interval, bool heartbeat);
     
     // This runs duplex
     void loop(bool valve);
@@ -108,4 +412,4 @@ class DuplexHandler {
     #endif /* DEBUG */
 };
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -14,7 +14,7 @@ Grandeur grandeur;
 
 Grandeur::Grandeur() {}
 
-Grandeur::Project::Project() {}
+Grandeur::Project::Project() : _duplex(NULL) {}
 
 Grandeur::Project::Project(DuplexHandler* duplex) : _duplex(duplex) {}
 
@@ -32,6 +32,11 @@ void Grandeur::Project::onConnection(void connectionCallback(bool)) {
   _duplex->onConnectionEvent(connectionCallback);
 }
 
+void Grandeur::Project::onConnectionAttempt(void attemptCallback(bool connected, unsigned long connectTime,
+                                                                 unsigned long handshakeTime)) {
+  _duplex->onConnectionAttempt(attemptCallback);
+}
+
 void Grandeur::Project::clearConnectionCallback(void) {
   // Clearing connection handler of its underlying duplex channel.
   _duplex->clearConnectionCallback();
@@ -41,6 +46,34 @@ bool Grandeur::Project::isConnected(void) {
   return (_duplex->getStatus() == CONNECTED);
 }
 
+size_t Grandeur::Project::queuedBytes(void) {
+  return _duplex->queuedBytes();
+}
+
+size_t Grandeur::Project::arenaUsed(void) {
+  return _duplex->arena().used();
+}
+
+void Grandeur::Project::enableBatching(unsigned long window) {
+  _duplex->enableBatching(window);
+}
+
+void Grandeur::Project::disableBatching(void) {
+  _duplex->disableBatching();
+}
+
+void Grandeur::Project::enableCoalescing(unsigned long window, size_t limit) {
+  _duplex->enableCoalescing(window, limit);
+}
+
+void Grandeur::Project::disableCoalescing(void) {
+  _duplex->disableCoalescing();
+}
+
+void Grandeur::Project::setKeepalive(unsigned long interval, bool heartbeat) {
+  _duplex->setKeepalive(interval, heartbeat);
+}
+
 Grandeur::Project::Device Grandeur::Project::device(String deviceId) {
   // Return the new device object.
   return Device(_duplex, deviceId);
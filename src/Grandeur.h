@@ -45,10 +45,43 @@ class Grandeur::Project {
     // Schedules a connection handler function to be called on successful connection establishment
     // with Grandeur.
     void onConnection(void connectionCallback(bool));
+    // Schedules a function to be called after every attempt to connect with whether it succeeded,
+    // and the milliseconds the TCP connect and the websocket handshake took. The handshake takes 0
+    // if the connect failed.
+    void onConnectionAttempt(void attemptCallback(bool connected, unsigned long connectTime,
+                                                  unsigned long handshakeTime));
     // Removes the connection handler function.
     void clearConnectionCallback(void);
     // Checks if we are connected with Grandeur.
     bool isConnected(void);
+    // Bytes sent that the network hasn't taken yet. They go out on loop(). Messages sent while
+    // more than WEBSOCKETS_TX_QUEUE_SIZE bytes are waiting get "SEND-QUEUE-FULL". Messages too
+    // large for a frame of the send buffer go out in fragments, one whenever the network has
+    // taken the last. Messages sent meanwhile are buffered behind them, or get "SEND-QUEUE-FULL"
+    // if they'd have to be streamed too.
+    size_t queuedBytes(void);
+    // Bytes of the JSON arena (JSON_ARENA_SIZE) held by payloads and messages still alive. It's 0
+    // between messages. If it isn't, a value built or parsed in the arena is being kept, and
+    // payloads are allocated on the heap until that value is freed.
+    size_t arenaUsed(void);
+
+    // Batches messages sent within window milliseconds, or within a loop when window is 0, into
+    // a single frame. Saves radio time for devices that send many variables at once.
+    void enableBatching(unsigned long window = 0);
+    // Sends every message in a frame of its own again.
+    void disableBatching(void);
+
+    // Holds device data sets back for window milliseconds and sends only the last value set on
+    // each path, also as soon as limit paths are pending. The callbacks of the sets replaced by
+    // later ones get "COALESCED".
+    void enableCoalescing(unsigned long window, size_t limit = COALESCE_LIMIT);
+    // Sends what's held back and sends every set right away again.
+    void disableCoalescing(void);
+
+    // Pings Grandeur only after interval milliseconds without messages either way (PING_INTERVAL
+    // by default), or never when it's 0. With heartbeat, pings are websocket ping frames of a few
+    // bytes instead of ping messages, and a connection whose pongs stop coming is dropped.
+    void setKeepalive(unsigned long interval, bool heartbeat = false);
 
     // Instantiator methods — return reference to objects of their classes.
     Device device(String deviceId);
@@ -91,6 +124,9 @@ class Grandeur::Project::Device {
         Event();
         Event(DuplexHandler* duplexHandler, String deviceId, String event, String path, gId id);
 
+        // Tells whether the listener is set. It isn't when there was no room left to keep its
+        // subscription for reconnects.
+        bool isListening();
         // Clear method
         void clear();
     };
@@ -114,7 +150,8 @@ class Grandeur::Project::Device {
         // Gets all variables from Grandeur and makes them available in cb function scope.
         void get(Callback cb);
         // Sets the variable specified in path with what's in the data and schedules cb function for when
-        // acknowledgement arrives from Grandeur.
+        // acknowledgement arrives from Grandeur. Data is moved into the message, so passing a temporary
+        // or std::move(var) sends it without copying.
         void set(const char* path, Var data, Callback cb);
         // Sets the variable specified in path with what's in the data without scheduling a function.
         void set(const char* path, Var data);
@@ -151,7 +188,7 @@ class Grandeur::Project::Datastore {
         // Constructor
         Collection(String name, DuplexHandler* duplexHandler);
 
-        // Inserts documents.
+        // Inserts documents. Like data, documents passed with std::move() aren't copied.
         void insert(Var documents, Callback inserted);
         // Removes documents matching the filter.
         void remove(Var filter, Callback removed);
@@ -4,5 +4,7 @@
 #define VAR_H_
 
 typedef JSONVar Var;
+// Non-owning view of a Var, e.g. for callbacks: void handler(const char* code, VarRef data).
+typedef const JSONVar& VarRef;
 
 #endif
\ No newline at end of file
@@ -28,6 +28,10 @@
 #include <core_esp8266_features.h>
 #endif
 
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32_ETH)
+#include <lwip/sockets.h>
+#endif
+
 extern "C" {
 #ifdef CORE_HAS_LIBB64
 #include <libb64/cencode.h>
@@ -55,6 +59,80 @@ extern "C" {
 
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define WEBSOCKETS_MASK_ALIGN 16
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WEBSOCKETS_MASK_ALIGN 16
+#else
+#define WEBSOCKETS_MASK_ALIGN sizeof(uintptr_t)
+#endif
+
+// payloads shorter than this are masked one byte at a time, lining up the key and the data
+// costs more than it saves on them
+#ifndef WEBSOCKETS_MASK_MIN
+#define WEBSOCKETS_MASK_MIN 32
+#endif
+
+// word the mask is applied with, allowed to alias the bytes of the payload
+typedef uintptr_t __attribute__((__may_alias__)) WSmaskWord_t;
+
+/**
+ * XOR data with the mask key, byte i with maskKey[i % 4]
+ * short payloads are done one by one. in longer ones, bytes are done one by one up to an aligned
+ * address, then a SIMD register (SSE2 / NEON) or a word at a time, then the tail one by one again.
+ * aligned accesses only, as the ESP8266 faults on unaligned words
+ * @param data uint8_t *         ptr to the payload
+ * @param length size_t          length of the payload
+ * @param maskKey uint8_t[4]     key used for payload
+ */
+void WebSockets::mask(uint8_t * data, size_t length, const uint8_t maskKey[4]) {
+    size_t i = 0;
+    if(length < WEBSOCKETS_MASK_MIN) {
+        // a copy of the key, which can't alias the data, lets the compiler keep it in registers
+        uint8_t key[4] = { maskKey[0], maskKey[1], maskKey[2], maskKey[3] };
+        for(; i < length; i++) {
+            data[i] ^= key[i & 3];
+        }
+        return;
+    }
+
+    while(i < length && ((uintptr_t)(data + i) % WEBSOCKETS_MASK_ALIGN) != 0) {
+        data[i] ^= maskKey[i & 3];
+        i++;
+    }
+
+    // key lined up with data + i, the steps below are multiples of 4
+    uint8_t key[16];
+    for(uint8_t x = 0; x < sizeof(key); x++) {
+        key[x] = maskKey[(i + x) & 3];
+    }
+
+#if defined(__SSE2__)
+    __m128i keyVector = _mm_loadu_si128((const __m128i *)key);
+    for(; i + 16 <= length; i += 16) {
+        __m128i * p = (__m128i *)(data + i);
+        _mm_store_si128(p, _mm_xor_si128(_mm_load_si128(p), keyVector));
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t keyVector = vld1q_u8(key);
+    for(; i + 16 <= length; i += 16) {
+        vst1q_u8(data + i, veorq_u8(vld1q_u8(data + i), keyVector));
+    }
+#endif
+
+    WSmaskWord_t keyWord;
+    memcpy(&keyWord, key, sizeof(keyWord));
+    for(; i + sizeof(keyWord) <= length; i += sizeof(keyWord)) {
+        *(WSmaskWord_t *)(data + i) ^= keyWord;
+    }
+
+    for(; i < length; i++) {
+        data[i] ^= maskKey[i & 3];
+    }
+}
+
 /**
  *
  * @param client WSclient_t *  ptr to the client struct
@@ -190,7 +268,7 @@ bool WebSockets::sendFrameHeader(WSclient_t * client, WSopcode_t opcode, size_t
  * @param payload uint8_t *     ptr to the payload
  * @param length size_t         length of the payload
  * @param fin bool              can be used to send data in more then one frame (set fin on the last frame)
- * @param headerToPayload bool  set true if the payload has reserved 14 Byte at the beginning to dynamically add the Header (payload neet to be in RAM!)
+ * @param headerToPayload bool  set true if the payload has reserved 14 Byte at the beginning to dynamically add the Header (payload neet to be in RAM!), a client masks it in place
  * @return true if ok
  */
 bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * payload, size_t length, bool fin, bool headerToPayload) {
@@ -204,6 +282,19 @@ bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * pay
         return false;
     }
 
+    // let the caller back off instead of queueing without end. control frames get a small
+    // allowance on top, so a pong or close still goes out behind a full queue. the rest of a
+    // started message isn't turned down, the peer can't take anything else until it's finished,
+    // so its sender has to pace it on WebSocketsClient::queuedBytes
+    size_t queueLimit = WEBSOCKETS_TX_QUEUE_SIZE;
+    if(opcode >= WSop_close) {
+        queueLimit += WEBSOCKETS_TX_QUEUE_CONTROL;
+    }
+    if(opcode != WSop_continuation && client->cTxQueued > queueLimit) {
+        DEBUG_WEBSOCKETS("[WS][%d][sendFrame] tx queue is full (%zu)\n", client->num, client->cTxQueued);
+        return false;
+    }
+
     DEBUG_WEBSOCKETS("[WS][%d][sendFrame] ------- send message frame -------\n", client->num);
     DEBUG_WEBSOCKETS("[WS][%d][sendFrame] fin: %u opCode: %u mask: %u length: %u headerToPayload: %u\n", client->num, fin, opcode, client->cIsClient, length, headerToPayload);
 
@@ -236,9 +327,14 @@ bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * pay
 #ifdef WEBSOCKETS_USE_BIG_MEM
     // only for ESP since AVR has less HEAP
     // try to send data in one TCP package (only if some free Heap is there)
-    if(!headerToPayload && ((length > 0) && (length < 1400)) && (GET_FREE_HEAP > 6000)) {
+    bool pack = !headerToPayload && ((length > 0) && (length < 1400)) && (GET_FREE_HEAP > 6000);
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
+    // writev sends header and payload together anyway, a copy is only needed to mask the payload
+    pack = pack && client->cIsClient;
+#endif
+    if(pack) {
         DEBUG_WEBSOCKETS("[WS][%d][sendFrame] pack to one TCP package...\n", client->num);
-        uint8_t * dataPtr = (uint8_t *)malloc(length + WEBSOCKETS_MAX_HEADER_SIZE);
+        uint8_t * dataPtr = _pool.take(length + WEBSOCKETS_MAX_HEADER_SIZE);
         if(dataPtr) {
             memcpy((dataPtr + WEBSOCKETS_MAX_HEADER_SIZE), payload, length);
             headerToPayload = true;
@@ -256,9 +352,11 @@ bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * pay
         headerPtr = &buffer[0];
     }
 
-    if(client->cIsClient && useInternBuffer) {
-        // if we use a Intern Buffer we can modify the data
-        // by this fact its possible the do the masking
+    // if we use a Intern Buffer we can modify the data, and so we can a payload the caller
+    // put room for the header in front of. by this fact its possible the do the masking
+    bool maskPayload = client->cIsClient && (useInternBuffer || headerToPayload);
+
+    if(maskPayload) {
         for(uint8_t x = 0; x < sizeof(maskKey); x++) {
             maskKey[x] = random(0xFF);
         }
@@ -266,7 +364,7 @@ bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * pay
 
     createHeader(headerPtr, opcode, length, client->cIsClient, maskKey, fin);
 
-    if(client->cIsClient && useInternBuffer) {
+    if(maskPayload) {
         uint8_t * dataMaskPtr;
 
         if(headerToPayload) {
@@ -275,9 +373,7 @@ bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * pay
             dataMaskPtr = payloadPtr;
         }
 
-        for(size_t x = 0; x < length; x++) {
-            dataMaskPtr[x] = (dataMaskPtr[x] ^ maskKey[x % 4]);
-        }
+        mask(dataMaskPtr, length, maskKey);
     }
 
 #ifndef NODEBUG_WEBSOCKETS
@@ -292,24 +388,18 @@ bool WebSockets::sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * pay
             ret = false;
         }
     } else {
-        // send header
-        if(write(client, &buffer[0], headerSize) != headerSize) {
+        // send header and payload
+        size_t payloadLen = payloadPtr ? length : 0;
+        if(write(client, &buffer[0], headerSize, payloadPtr, payloadLen) != (headerSize + payloadLen)) {
             ret = false;
         }
-
-        if(payloadPtr && length > 0) {
-            // send payload
-            if(write(client, &payloadPtr[0], length) != length) {
-                ret = false;
-            }
-        }
     }
 
     DEBUG_WEBSOCKETS("[WS][%d][sendFrame] sending Frame Done (%luus).\n", client->num, (micros() - start));
 
 #ifdef WEBSOCKETS_USE_BIG_MEM
     if(useInternBuffer && payloadPtr) {
-        free(payloadPtr);
+        _pool.give(payloadPtr);
     }
 #endif
 
@@ -335,6 +425,13 @@ void WebSockets::headerDone(WSclient_t * client) {
  * @param client WSclient_t *  ptr to the client struct
  */
 void WebSockets::handleWebsocket(WSclient_t * client) {
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+    // go on with a frame that came in part way first
+    if(client->cRxLeft > 0) {
+        readPending(client);
+        return;
+    }
+#endif
     if(client->cWsRXsize == 0) {
         handleWebsocketCb(client);
     }
@@ -360,19 +457,19 @@ bool WebSockets::handleWebsocketWaitFor(WSclient_t * client, size_t size) {
     }
 
     DEBUG_WEBSOCKETS("[WS][%d][handleWebsocketWaitFor] size: %d cWsRXsize: %d\n", client->num, size, client->cWsRXsize);
-    readCb(client, &client->cWsHeader[client->cWsRXsize], (size - client->cWsRXsize), std::bind([](WebSockets * server, size_t size, WSclient_t * client, bool ok) {
+    // captures no more than two pointers, small enough for std::function to keep without allocating
+    readCb(client, &client->cWsHeader[client->cWsRXsize], (size - client->cWsRXsize), [this, size](WSclient_t * client, bool ok) {
         DEBUG_WEBSOCKETS("[WS][%d][handleWebsocketWaitFor][readCb] size: %d ok: %d\n", client->num, size, ok);
         if(ok) {
             client->cWsRXsize = size;
-            server->handleWebsocketCb(client);
+            handleWebsocketCb(client);
         } else {
             DEBUG_WEBSOCKETS("[WS][%d][readCb] failed.\n", client->num);
             client->cWsRXsize = 0;
             // timeout or error
-            server->clientDisconnect(client, 1002);
+            clientDisconnect(client, 1002);
         }
-    },
-                                                                                          this, size, std::placeholders::_1, std::placeholders::_2));
+    });
     return false;
 }
 
@@ -448,14 +545,20 @@ void WebSockets::handleWebsocketCb(WSclient_t * client) {
 
     if(header->payloadLen > 0) {
         // if text data we need one more
-        payload = (uint8_t *)malloc(header->payloadLen + 1);
+        payload = _pool.take(header->payloadLen + 1);
 
         if(!payload) {
             DEBUG_WEBSOCKETS("[WS][%d][handleWebsocket] to less memory to handle payload %d!\n", client->num, header->payloadLen);
             clientDisconnect(client, 1011);
             return;
         }
-        readCb(client, payload, header->payloadLen, std::bind(&WebSockets::handleWebsocketPayloadCb, this, std::placeholders::_1, std::placeholders::_2, payload));
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+        // kept to be freed if the client disconnects while the payload comes in
+        client->cWsPayload = payload;
+#endif
+        readCb(client, payload, header->payloadLen, [this, payload](WSclient_t * client, bool ok) {
+            handleWebsocketPayloadCb(client, ok, payload);
+        });
     } else {
         handleWebsocketPayloadCb(client, true, NULL);
     }
@@ -463,18 +566,26 @@ void WebSockets::handleWebsocketCb(WSclient_t * client) {
 
 void WebSockets::handleWebsocketPayloadCb(WSclient_t * client, bool ok, uint8_t * payload) {
     WSMessageHeader_t * header = &client->cWsHeaderDecode;
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+    client->cWsPayload = NULL;
+#endif
     if(ok) {
         if(header->payloadLen > 0) {
             payload[header->payloadLen] = 0x00;
 
             if(header->mask) {
                 //decode XOR
-                for(size_t i = 0; i < header->payloadLen; i++) {
-                    payload[i] = (payload[i] ^ header->maskKey[i % 4]);
-                }
+                mask(payload, header->payloadLen, header->maskKey);
             }
         }
 
+        // any frame shows the connection is alive as well as a pong does,
+        // so the heartbeat only pings after pingInterval without one
+        if(client->pingInterval) {
+            client->lastPing     = millis();
+            client->pongReceived = true;
+        }
+
         switch(header->opCode) {
             case WSop_text:
                 DEBUG_WEBSOCKETS("[WS][%d][handleWebsocket] text: %s\n", client->num, payload);
@@ -516,7 +627,7 @@ void WebSockets::handleWebsocketPayloadCb(WSclient_t * client, bool ok, uint8_t
         }
 
         if(payload) {
-            free(payload);
+            _pool.give(payload);
         }
 
         // reset input
@@ -528,7 +639,7 @@ void WebSockets::handleWebsocketPayloadCb(WSclient_t * client, bool ok, uint8_t
 
     } else {
         DEBUG_WEBSOCKETS("[WS][%d][handleWebsocket] missing data!\n", client->num);
-        free(payload);
+        _pool.give(payload);
         clientDisconnect(client, 1002);
     }
 }
@@ -602,108 +713,219 @@ bool WebSockets::readCb(WSclient_t * client, uint8_t * out, size_t n, WSreadWait
                                        client, std::placeholders::_1, cb));
 
 #else
-    unsigned long t = millis();
-    ssize_t len;
-    DEBUG_WEBSOCKETS("[readCb] n: %zu t: %lu\n", n, t);
-    while(n > 0) {
-        if(client->tcp == NULL) {
-            DEBUG_WEBSOCKETS("[readCb] tcp is null!\n");
-            if(cb) {
-                cb(client, false);
-            }
-            return false;
+    DEBUG_WEBSOCKETS("[readCb] n: %zu t: %lu\n", n, millis());
+    if(client->tcp == NULL || !client->tcp->connected()) {
+        DEBUG_WEBSOCKETS("[readCb] not connected!\n");
+        if(cb) {
+            cb(client, false);
         }
+        return false;
+    }
+
+    // takes what's there and goes on in handleWebsocket() as more comes in
+    client->cRxOut  = out;
+    client->cRxLeft = n;
+    client->cRxTime = millis();
+    client->cRxCb   = std::move(cb);
+    return readPending(client);
+#endif
+    return true;
+}
 
-        if(!client->tcp->connected()) {
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+/**
+ * read what's available for the pending read without waiting for more
+ * @param client WSclient_t *
+ * @return true if the read is done
+ */
+bool WebSockets::readPending(WSclient_t * client) {
+    while(client->cRxLeft > 0) {
+        if(client->tcp == NULL || !client->tcp->connected()) {
             DEBUG_WEBSOCKETS("[readCb] not connected!\n");
-            if(cb) {
-                cb(client, false);
-            }
-            return false;
+            return readDone(client, false);
         }
 
-        if((millis() - t) > WEBSOCKETS_TCP_TIMEOUT) {
-            DEBUG_WEBSOCKETS("[readCb] receive TIMEOUT! %lu\n", (millis() - t));
-            if(cb) {
-                cb(client, false);
+        if(!client->tcp->available()) {
+            if((millis() - client->cRxTime) > WEBSOCKETS_TCP_TIMEOUT) {
+                DEBUG_WEBSOCKETS("[readCb] receive TIMEOUT! %lu\n", (millis() - client->cRxTime));
+                return readDone(client, false);
             }
             return false;
         }
 
-        if(!client->tcp->available()) {
-            WEBSOCKETS_YIELD_MORE();
-            continue;
-        }
-
-        len = client->tcp->read((uint8_t *)out, n);
-        if(len > 0) {
-            t = millis();
-            out += len;
-            n -= len;
-            //DEBUG_WEBSOCKETS("Receive %d left %d!\n", len, n);
-        } else {
-            //DEBUG_WEBSOCKETS("Receive %d left %d!\n", len, n);
-        }
-        if(n > 0) {
-            WEBSOCKETS_YIELD();
+        ssize_t len = client->tcp->read(client->cRxOut, client->cRxLeft);
+        if(len <= 0) {
+            return false;
         }
+        client->cRxTime = millis();
+        client->cRxOut += len;
+        client->cRxLeft -= len;
     }
+    return readDone(client, true);
+}
+
+/**
+ * end the pending read and call its callback
+ * @param client WSclient_t *
+ * @param ok bool
+ * @return ok
+ */
+bool WebSockets::readDone(WSclient_t * client, bool ok) {
+    // the callback may start the next read
+    WSreadWaitCb cb = std::move(client->cRxCb);
+    client->cRxOut  = NULL;
+    client->cRxLeft = 0;
+    client->cRxCb   = nullptr;
     if(cb) {
-        cb(client, true);
+        cb(client, ok);
     }
-    WEBSOCKETS_YIELD();
+    return ok;
+}
+
+/**
+ * forget the pending read and the payload it was reading into, when the client disconnects
+ * @param client WSclient_t *
+ */
+void WebSockets::dropPendingRead(WSclient_t * client) {
+    client->cRxOut  = NULL;
+    client->cRxLeft = 0;
+    client->cRxCb   = nullptr;
+    if(client->cWsPayload) {
+        _pool.give(client->cWsPayload);
+        client->cWsPayload = NULL;
+    }
+}
 #endif
-    return true;
+
+/**
+ * write what the tcp stack takes without waiting for room in its send window
+ * on ESP32 this only holds without ssl, WiFiClientSecure::write still waits
+ * @param client WSclient_t *
+ * @param out  uint8_t * data buffer
+ * @param n size_t byte count
+ * @return bytes taken
+ */
+static size_t writeAvailable(WSclient_t * client, const uint8_t * out, size_t n) {
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266)
+    // WiFiClient::write waits for room, so only what fits now is written
+    size_t room = client->tcp->availableForWrite();
+    if(n > room) {
+        n = room;
+    }
+    if(n == 0) {
+        return 0;
+    }
+#elif(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32_ETH)
+    // WiFiClient::write waits until the socket took all of it, so the socket is written directly
+#if defined(HAS_SSL)
+    if(!client->isSSL)
+#endif
+    {
+        int len = send(client->tcp->fd(), out, n, MSG_DONTWAIT);
+        return len > 0 ? len : 0;
+    }
+#endif
+    return client->tcp->write(out, n);
 }
 
 /**
- * write x byte to tcp or get timeout
+ * write x byte to tcp, queueing what it doesn't take right away
+ * the queue is sent on loop, so this never waits for the tcp stack
  * @param client WSclient_t *
  * @param out  uint8_t * data buffer
  * @param n size_t byte count
- * @return bytes send
+ * @return bytes sent or queued
  */
 size_t WebSockets::write(WSclient_t * client, uint8_t * out, size_t n) {
     if(out == NULL)
         return 0;
     if(client == NULL)
         return 0;
-    unsigned long t = millis();
-    size_t len      = 0;
-    size_t total    = 0;
-    DEBUG_WEBSOCKETS("[write] n: %zu t: %lu\n", n, t);
-    while(n > 0) {
-        if(client->tcp == NULL) {
-            DEBUG_WEBSOCKETS("[write] tcp is null!\n");
-            break;
-        }
+    if(client->tcp == NULL || !client->tcp->connected()) {
+        DEBUG_WEBSOCKETS("[write] not connected!\n");
+        return 0;
+    }
+    DEBUG_WEBSOCKETS("[write] n: %zu queued: %zu\n", n, client->cTxQueued);
+
+    size_t total = n;
+    // bytes have to go out in order, so only once the queue is empty
+    handleTxQueue(client);
+    if(client->cTxQueued == 0) {
+        size_t len = writeAvailable(client, (const uint8_t *)out, n);
+        out += len;
+        n -= len;
+    }
 
-        if(!client->tcp->connected()) {
-            DEBUG_WEBSOCKETS("[write] not connected!\n");
-            break;
-        }
+    if(n > 0 && !queueWrite(client, out, n)) {
+        return total - n;
+    }
+    return total;
+}
 
-        if((millis() - t) > WEBSOCKETS_TCP_TIMEOUT) {
-            DEBUG_WEBSOCKETS("[write] write TIMEOUT! %lu\n", (millis() - t));
-            break;
-        }
+/**
+ * add bytes to the end of the tx queue.
+ * sendFrame only starts a frame within the limit, so the queue grows to at most
+ * WEBSOCKETS_TX_QUEUE_SIZE + WEBSOCKETS_TX_QUEUE_CONTROL and one frame, plus the continuation
+ * frames a sender queues behind it
+ * @param client WSclient_t *
+ * @param out  uint8_t * data buffer
+ * @param n size_t byte count
+ * @return true if ok
+ */
+bool WebSockets::queueWrite(WSclient_t * client, const uint8_t * out, size_t n) {
+    if(client->cTxHead > 0 && client->cTxHead + client->cTxQueued + n > client->cTxQueueSize) {
+        // slide the queued bytes back to the start before growing the queue
+        memmove(client->cTxQueue, client->cTxQueue + client->cTxHead, client->cTxQueued);
+        client->cTxHead = 0;
+    }
 
-        len = client->tcp->write((const uint8_t *)out, n);
-        if(len) {
-            t = millis();
-            out += len;
-            n -= len;
-            total += len;
-            //DEBUG_WEBSOCKETS("write %d left %d!\n", len, n);
-        } else {
-            DEBUG_WEBSOCKETS("WS write %d failed left %d!\n", len, n);
+    if(client->cTxQueued + n > client->cTxQueueSize) {
+        size_t size = client->cTxQueueSize ? client->cTxQueueSize * 2 : 1024;
+        if(size < client->cTxQueued + n) {
+            size = client->cTxQueued + n;
         }
-        if(n > 0) {
-            WEBSOCKETS_YIELD();
+        uint8_t * queue = (uint8_t *)realloc(client->cTxQueue, size);
+        if(!queue) {
+            DEBUG_WEBSOCKETS("[write] to less memory to queue %zu bytes!\n", n);
+            return false;
         }
+        client->cTxQueue     = queue;
+        client->cTxQueueSize = size;
     }
-    WEBSOCKETS_YIELD();
-    return total;
+
+    memcpy(client->cTxQueue + client->cTxHead + client->cTxQueued, out, n);
+    client->cTxQueued += n;
+    return true;
+}
+
+/**
+ * send as much of the tx queue as the tcp stack takes
+ * @param client WSclient_t *
+ */
+void WebSockets::handleTxQueue(WSclient_t * client) {
+    if(client->cTxQueued == 0 || client->tcp == NULL || !client->tcp->connected()) {
+        return;
+    }
+
+    size_t len = writeAvailable(client, client->cTxQueue + client->cTxHead, client->cTxQueued);
+    client->cTxHead += len;
+    client->cTxQueued -= len;
+    // the queue is kept for the next time the tcp stack falls behind
+    if(client->cTxQueued == 0) {
+        client->cTxHead = 0;
+    }
+}
+
+/**
+ * forget the tx queue when the client disconnects
+ * @param client WSclient_t *
+ */
+void WebSockets::dropTxQueue(WSclient_t * client) {
+    free(client->cTxQueue);
+    client->cTxQueue     = NULL;
+    client->cTxQueueSize = 0;
+    client->cTxHead      = 0;
+    client->cTxQueued    = 0;
 }
 
 size_t WebSockets::write(WSclient_t * client, const char * out) {
@@ -714,6 +936,56 @@ size_t WebSockets::write(WSclient_t * client, const char * out) {
     return write(client, (uint8_t *)out, strlen(out));
 }
 
+/**
+ * write a header and the payload after it, with one call to the tcp stack where the network
+ * class has writev, queueing what it doesn't take right away like write()
+ * @param client WSclient_t *
+ * @param header uint8_t *
+ * @param headerLen size_t
+ * @param payload uint8_t * may be NULL if n is 0
+ * @param n size_t payload length
+ * @return bytes sent or queued
+ */
+size_t WebSockets::write(WSclient_t * client, uint8_t * header, size_t headerLen, uint8_t * payload, size_t n) {
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
+    if(header == NULL)
+        return 0;
+    if(client == NULL)
+        return 0;
+    if(client->tcp == NULL || !client->tcp->connected()) {
+        DEBUG_WEBSOCKETS("[write] not connected!\n");
+        return 0;
+    }
+    DEBUG_WEBSOCKETS("[write] n: %zu + %zu queued: %zu\n", headerLen, n, client->cTxQueued);
+
+    size_t total = headerLen + n;
+    size_t len   = 0;
+    handleTxQueue(client);
+    if(client->cTxQueued == 0) {
+        struct iovec iov[2] = { { header, headerLen }, { payload, n } };
+        len                 = client->tcp->writev(iov, n > 0 ? 2 : 1);
+    }
+
+    // queue what's left of the header, then of the payload
+    if(len < headerLen) {
+        if(!queueWrite(client, header + len, headerLen - len)) {
+            return len;
+        }
+        len = headerLen;
+    }
+    if(len < total && !queueWrite(client, payload + (len - headerLen), total - len)) {
+        return len;
+    }
+    return total;
+#else
+    size_t len = write(client, header, headerLen);
+    if(len == headerLen && n > 0) {
+        len += write(client, payload, n);
+    }
+    return len;
+#endif
+}
+
 /**
  * enable ping/pong heartbeat process
  * @param client WSclient_t *
@@ -755,3 +1027,81 @@ void WebSockets::handleHBTimeout(WSclient_t * client) {
         }
     }
 }
+
+// slab size and count of each size class, smallest first
+static const size_t poolSlabSize[]  = { 256, 1024, 4096 };
+static const size_t poolSlabCount[] = { WEBSOCKETS_POOL_256, WEBSOCKETS_POOL_1K, WEBSOCKETS_POOL_4K };
+
+WebSocketsPool::~WebSocketsPool(void) {
+    free(_block);
+}
+
+/**
+ * allocate all slabs in one block, only the first call does anything
+ * if there's not enough heap for it, every buffer comes from the heap
+ */
+void WebSocketsPool::reserve(void) {
+    if(_block) {
+        return;
+    }
+
+    size_t total = 0;
+    for(uint8_t c = 0; c < CLASSES; c++) {
+        total += poolSlabSize[c] * poolSlabCount[c];
+    }
+    if(total == 0) {
+        return;
+    }
+
+    _block = (uint8_t *)malloc(total);
+    if(!_block) {
+        DEBUG_WEBSOCKETS("[WS-Pool] no memory for %u byte of slabs!\n", total);
+        return;
+    }
+
+    uint8_t * slab = _block;
+    for(uint8_t c = 0; c < CLASSES; c++) {
+        for(size_t i = 0; i < poolSlabCount[c]; i++) {
+            memcpy(slab, &_free[c], sizeof(uint8_t *));
+            _free[c] = slab;
+            slab += poolSlabSize[c];
+        }
+        _end[c] = slab;
+    }
+}
+
+/**
+ * get a buffer from the smallest free slab that fits, or from the heap
+ * @param size size_t
+ * @return uint8_t * buffer to hand back with give(), NULL if out of memory
+ */
+uint8_t * WebSocketsPool::take(size_t size) {
+    for(uint8_t c = 0; c < CLASSES; c++) {
+        if(size <= poolSlabSize[c] && _free[c]) {
+            uint8_t * slab = _free[c];
+            memcpy(&_free[c], slab, sizeof(uint8_t *));
+            _hits++;
+            return slab;
+        }
+    }
+    _misses++;
+    return (uint8_t *)malloc(size);
+}
+
+/**
+ * hand back a buffer from take()
+ * @param buffer uint8_t *
+ */
+void WebSocketsPool::give(uint8_t * buffer) {
+    if(!_block || buffer < _block || buffer >= _end[CLASSES - 1]) {
+        free(buffer);
+        return;
+    }
+    for(uint8_t c = 0; c < CLASSES; c++) {
+        if(buffer < _end[c]) {
+            memcpy(buffer, &_free[c], sizeof(uint8_t *));
+            _free[c] = buffer;
+            return;
+        }
+    }
+}
@@ -82,6 +82,15 @@
 #define WEBSOCKETS_YIELD_MORE() delay(1)
 #endif
 
+#elif defined(__linux__)
+
+// host build, see extras/host
+#define WEBSOCKETS_MAX_DATA_SIZE (15 * 1024)
+#define WEBSOCKETS_USE_BIG_MEM
+#define GET_FREE_HEAP (64 * 1024)
+#define WEBSOCKETS_YIELD() yield()
+#define WEBSOCKETS_YIELD_MORE() delay(1)
+
 #elif defined(STM32_DEVICE)
 
 #define WEBSOCKETS_MAX_DATA_SIZE (15 * 1024)
@@ -101,12 +110,51 @@
 
 #define WEBSOCKETS_TCP_TIMEOUT (5000)
 
+// bytes the tcp stack doesn't take right away are queued and sent on loop.
+// no new message is started while more than this many bytes are queued.
+// on ESP32 with ssl, WiFiClientSecure::write still waits until the socket takes the record,
+// so loop can block for as long as the network lags
+#ifndef WEBSOCKETS_TX_QUEUE_SIZE
+#define WEBSOCKETS_TX_QUEUE_SIZE (4 * 1024)
+#endif
+
+// control frames (ping, pong, close) may still be queued this many bytes past the limit
+#ifndef WEBSOCKETS_TX_QUEUE_CONTROL
+#define WEBSOCKETS_TX_QUEUE_CONTROL (256)
+#endif
+
+// received payloads, and small frames sent through an intern buffer, are taken from slabs
+// reserved at begin() so steady traffic doesn't fragment the heap.
+// number of 256 Byte, 1 KB and 4 KB slabs, anything bigger or beyond them comes from the heap
+#ifdef WEBSOCKETS_USE_BIG_MEM
+#ifndef WEBSOCKETS_POOL_256
+#define WEBSOCKETS_POOL_256 (4)
+#endif
+#ifndef WEBSOCKETS_POOL_1K
+#define WEBSOCKETS_POOL_1K (2)
+#endif
+#ifndef WEBSOCKETS_POOL_4K
+#define WEBSOCKETS_POOL_4K (1)
+#endif
+#else
+#ifndef WEBSOCKETS_POOL_256
+#define WEBSOCKETS_POOL_256 (0)
+#endif
+#ifndef WEBSOCKETS_POOL_1K
+#define WEBSOCKETS_POOL_1K (0)
+#endif
+#ifndef WEBSOCKETS_POOL_4K
+#define WEBSOCKETS_POOL_4K (0)
+#endif
+#endif
+
 #define NETWORK_ESP8266_ASYNC (0)
 #define NETWORK_ESP8266 (1)
 #define NETWORK_W5100 (2)
 #define NETWORK_ENC28J60 (3)
 #define NETWORK_ESP32 (4)
 #define NETWORK_ESP32_ETH (5)
+#define NETWORK_POSIX (6)
 
 // max size of the WS Message Header
 #define WEBSOCKETS_MAX_HEADER_SIZE (14)
@@ -121,6 +169,8 @@
 #elif defined(ESP32)
 #define WEBSOCKETS_NETWORK_TYPE NETWORK_ESP32
 //#define WEBSOCKETS_NETWORK_TYPE NETWORK_ESP32_ETH
+#elif defined(__linux__)
+#define WEBSOCKETS_NETWORK_TYPE NETWORK_POSIX
 #else
 #define WEBSOCKETS_NETWORK_TYPE NETWORK_W5100
 
@@ -161,6 +211,7 @@
 #include <ESP8266WiFi.h>
 #if defined(wificlientbearssl_h) && !defined(USING_AXTLS) && !defined(wificlientsecure_h)
 #define SSL_BARESSL
+#define WEBSOCKETS_NETWORK_SSL_SESSION_CLASS BearSSL::Session
 #else
 #define SSL_AXTLS
 #endif
@@ -204,6 +255,21 @@
 #define WEBSOCKETS_NETWORK_CLASS WiFiClient
 #define WEBSOCKETS_NETWORK_SERVER_CLASS WiFiServer
 
+#elif(WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
+
+#if !defined(__linux__)
+#error "network type POSIX only possible on a linux host!"
+#endif
+
+#include <PosixNetwork.h>
+#define WEBSOCKETS_NETWORK_CLASS PosixClient
+#define WEBSOCKETS_NETWORK_SERVER_CLASS PosixServer
+#ifdef POSIX_TLS
+#define SSL_AXTLS
+#define WEBSOCKETS_NETWORK_SSL_CLASS PosixSecureClient
+#define WEBSOCKETS_NETWORK_SSL_SESSION_CLASS PosixSecureSession
+#endif
+
 #else
 #error "no network type selected!"
 #endif
@@ -265,7 +331,7 @@ typedef struct {
     uint8_t * maskKey;
 } WSMessageHeader_t;
 
-typedef struct {
+typedef struct WSclient_s {
     void init(uint8_t num,
         uint32_t pingInterval,
         uint32_t pongTimeout,
@@ -286,7 +352,7 @@ typedef struct {
 
 #if defined(HAS_SSL)
     bool isSSL = false;    ///< run in ssl mode
-    WEBSOCKETS_NETWORK_SSL_CLASS * ssl;
+    WEBSOCKETS_NETWORK_SSL_CLASS * ssl = NULL;    ///< kept between connections of a client
 #endif
 
     String cUrl;           ///< http url
@@ -307,6 +373,19 @@ typedef struct {
     uint8_t cWsHeader[WEBSOCKETS_MAX_HEADER_SIZE];    ///< RX WS Message buffer
     WSMessageHeader_t cWsHeaderDecode;
 
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+    uint8_t * cRxOut      = NULL;    ///< where the pending read puts the next bytes
+    size_t cRxLeft        = 0;       ///< bytes the pending read still waits for, 0 if there's none
+    unsigned long cRxTime = 0;       ///< millis when the pending read last got data
+    std::function<void(struct WSclient_s * client, bool ok)> cRxCb;    ///< called once the pending read is done
+    uint8_t * cWsPayload = NULL;     ///< payload of the frame being read
+#endif
+
+    uint8_t * cTxQueue  = NULL;    ///< bytes written that the tcp stack didn't take yet
+    size_t cTxQueueSize = 0;       ///< allocated size of cTxQueue
+    size_t cTxHead      = 0;       ///< offset of the first queued byte
+    size_t cTxQueued    = 0;       ///< number of queued bytes
+
     String base64Authorization;    ///< Base64 encoded Auth request
     String plainAuthorization;     ///< Base64 encoded Auth request
 
@@ -328,6 +407,35 @@ typedef struct {
 
 } WSclient_t;
 
+class WebSocketsPool {
+  public:
+    WebSocketsPool(void) {}
+    ~WebSocketsPool(void);
+
+    void reserve(void);
+    uint8_t * take(size_t size);
+    void give(uint8_t * buffer);
+
+    uint32_t hits(void) const {
+        return _hits;
+    }
+    uint32_t misses(void) const {
+        return _misses;
+    }
+
+  private:
+    WebSocketsPool(const WebSocketsPool &) = delete;
+    WebSocketsPool & operator=(const WebSocketsPool &) = delete;
+
+    static const uint8_t CLASSES = 3;
+
+    uint8_t * _block         = NULL;    ///< all slabs, smallest first
+    uint8_t * _end[CLASSES]  = {};      ///< end of each size class in _block
+    uint8_t * _free[CLASSES] = {};      ///< free slabs of each size class, linked through their first bytes
+    uint32_t _hits           = 0;       ///< buffers taken from a slab
+    uint32_t _misses         = 0;       ///< buffers taken from the heap
+};
+
 class WebSockets {
   protected:
 #ifdef __AVR__
@@ -359,11 +467,29 @@ class WebSockets {
     String base64_encode(uint8_t * data, size_t length);
 
     bool readCb(WSclient_t * client, uint8_t * out, size_t n, WSreadWaitCb cb);
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+    bool readPending(WSclient_t * client);
+    bool readDone(WSclient_t * client, bool ok);
+    void dropPendingRead(WSclient_t * client);
+#endif
     virtual size_t write(WSclient_t * client, uint8_t * out, size_t n);
     size_t write(WSclient_t * client, const char * out);
+    size_t write(WSclient_t * client, uint8_t * header, size_t headerLen, uint8_t * payload, size_t n);
+    bool queueWrite(WSclient_t * client, const uint8_t * out, size_t n);
+    void handleTxQueue(WSclient_t * client);
+    void dropTxQueue(WSclient_t * client);
 
     void enableHeartbeat(WSclient_t * client, uint32_t pingInterval, uint32_t pongTimeout, uint8_t disconnectTimeoutCount);
     void handleHBTimeout(WSclient_t * client);
+
+    WebSocketsPool _pool;
+
+  public:
+    static void mask(uint8_t * data, size_t length, const uint8_t maskKey[4]);
+
+    const WebSocketsPool & pool(void) const {
+        return _pool;
+    }
 };
 
 #ifndef UNUSED
@@ -27,16 +27,21 @@
 
 WebSocketsClient::WebSocketsClient() {
     _cbEvent             = NULL;
+    _cbAttempt           = NULL;
     _client.num          = 0;
     _client.cIsClient    = true;
     _client.extraHeaders = WEBSOCKETS_STRING("Origin: file://");
-    _reconnectInterval   = 500;
+    _reconnectWait       = 0;
+    _connectTime         = 0;
     _port                = 0;
     _host                = "";
 }
 
 WebSocketsClient::~WebSocketsClient() {
     disconnect();
+#if defined(HAS_SSL)
+    delete _client.ssl;
+#endif
 }
 
 /**
@@ -55,7 +60,9 @@ void WebSocketsClient::begin(const char * host, uint16_t port, const char * url,
     _client.tcp    = NULL;
 #if defined(HAS_SSL)
     _client.isSSL = false;
-    _client.ssl   = NULL;
+    // a secure client kept from an earlier begin() may be set up for another server
+    delete _client.ssl;
+    _client.ssl = NULL;
 #endif
     _client.cUrl                = url;
     _client.cCode               = 0;
@@ -74,8 +81,14 @@ void WebSocketsClient::begin(const char * host, uint16_t port, const char * url,
     _client.pongReceived     = false;
     _client.pongTimeoutCount = 0;
 
+    _pool.reserve();
+
+    // the seed has to differ between devices, or their reconnect jitter is the same
 #ifdef ESP8266
     randomSeed(RANDOM_REG32);
+#elif defined(ESP32)
+#define DR_REG_RNG_BASE 0x3ff75144
+    randomSeed(READ_PERI_REG(DR_REG_RNG_BASE));
 #else
     // todo find better seed
     randomSeed(millis());
@@ -86,6 +99,8 @@ void WebSocketsClient::begin(const char * host, uint16_t port, const char * url,
 
     _lastConnectionFail = 0;
     _lastHeaderSent     = 0;
+    _reconnectWait      = 0;
+    _reconnect.reset();
 
     DEBUG_WEBSOCKETS("[WS-Client] Websocket Version: " WEBSOCKETS_VERSION "\n");
 }
@@ -204,23 +219,26 @@ void WebSocketsClient::loop(void) {
     WEBSOCKETS_YIELD();
     if(!clientIsConnected(&_client)) {
         // do not flood the server
-        if((millis() - _lastConnectionFail) < _reconnectInterval) {
+        if((millis() - _lastConnectionFail) < _reconnectWait) {
             return;
         }
 
 #if defined(HAS_SSL)
         if(_client.isSSL) {
             DEBUG_WEBSOCKETS("[WS-Client] connect wss...\n");
-            if(_client.ssl) {
-                delete _client.ssl;
-                _client.ssl = NULL;
-                _client.tcp = NULL;
+            // the secure client and its buffers are kept between connections,
+            // only its settings are applied again
+            if(!_client.ssl) {
+                _client.ssl = new WEBSOCKETS_NETWORK_SSL_CLASS();
             }
-            _client.ssl = new WEBSOCKETS_NETWORK_SSL_CLASS();
             _client.tcp = _client.ssl;
+#ifdef WEBSOCKETS_NETWORK_SSL_SESSION_CLASS
+            // resumes the last session, which skips most of the handshake
+            _client.ssl->setSession(&_session);
+#endif
             if(_CA_cert) {
                 DEBUG_WEBSOCKETS("[WS-Client] setting CA certificate");
-#if defined(ESP32)
+#if defined(ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
                 _client.ssl->setCACert(_CA_cert);
 #elif defined(ESP8266) && defined(SSL_AXTLS)
                 _client.ssl->setCACert((const uint8_t *)_CA_cert, strlen(_CA_cert) + 1);
@@ -229,9 +247,9 @@ void WebSocketsClient::loop(void) {
 #else
 #error setCACert not implemented
 #endif
-#if defined(ESP32)
+#if defined(ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
             } else if(!SSL_FINGERPRINT_IS_SET) {
-                Serial.println("SET INSECURE.");
+                DEBUG_WEBSOCKETS("[WS-Client] setting insecure\n");
                 _client.ssl->setInsecure();
 #elif defined(SSL_BARESSL)
             } else if(SSL_FINGERPRINT_IS_SET) {
@@ -261,11 +279,14 @@ void WebSocketsClient::loop(void) {
             return;
         }
         WEBSOCKETS_YIELD();
+        unsigned long start = millis();
 #if defined(ESP32)
-        if(_client.tcp->connect(_host.c_str(), _port, WEBSOCKETS_TCP_TIMEOUT)) {
+        bool connected = _client.tcp->connect(_host.c_str(), _port, WEBSOCKETS_TCP_TIMEOUT);
 #else
-        if(_client.tcp->connect(_host.c_str(), _port)) {
+        bool connected = _client.tcp->connect(_host.c_str(), _port);
 #endif
+        _connectTime = millis() - start;
+        if(connected) {
             connectedCb();
             _lastConnectionFail = 0;
         } else {
@@ -273,6 +294,7 @@ void WebSocketsClient::loop(void) {
             _lastConnectionFail = millis();
         }
     } else {
+        handleTxQueue(&_client);
         handleClientData();
         WEBSOCKETS_YIELD();
         if(_client.status == WSC_CONNECTED) {
@@ -350,6 +372,31 @@ bool WebSocketsClient::sendBIN(const uint8_t * payload, size_t length) {
     return sendBIN((uint8_t *)payload, length);
 }
 
+/**
+ * send one frame of a fragmented message
+ * @param opcode WSopcode_t     WSop_text or WSop_binary for the first frame, WSop_continuation after it
+ * @param payload uint8_t *
+ * @param length size_t
+ * @param fin bool              set on the last frame of the message
+ * @param headerToPayload bool  (see sendFrame for more details)
+ * @return true if ok
+ */
+bool WebSocketsClient::sendFragment(WSopcode_t opcode, uint8_t * payload, size_t length, bool fin, bool headerToPayload) {
+    if(clientIsConnected(&_client)) {
+        return sendFrame(&_client, opcode, payload, length, fin, headerToPayload);
+    }
+    return false;
+}
+
+/**
+ * bytes written that the tcp stack didn't take yet
+ * no new message is sent while there are more than WEBSOCKETS_TX_QUEUE_SIZE of them
+ * @return size_t
+ */
+size_t WebSocketsClient::queuedBytes(void) {
+    return _client.cTxQueued;
+}
+
 /**
  * sends a WS ping to Server
  * @param payload uint8_t *
@@ -416,11 +463,30 @@ void WebSocketsClient::setExtraHeaders(const char * extraHeaders) {
 
 /**
  * set the reconnect Interval
- * how long to wait after a connection initiate failed
+ * how long to wait after a connection initiate failed, the first retry goes right away
  * @param time in ms
  */
 void WebSocketsClient::setReconnectInterval(unsigned long time) {
-    _reconnectInterval = time;
+    _reconnect.set(time, time);
+}
+
+/**
+ * back off from reconnecting: the first retry goes right away, then the wait grows at random
+ * from base up to max
+ * @param base unsigned long ms
+ * @param max unsigned long ms
+ */
+void WebSocketsClient::setReconnectBackoff(unsigned long base, unsigned long max) {
+    _reconnect.set(base, max);
+}
+
+/**
+ * set callback function reporting every connection attempt
+ * @param cbAttempt WebSocketClientAttemptEvent called with whether the websocket connection came up,
+ *                  the ms the tcp (and tls) connect took and the ms the handshake took, 0 if it didn't start
+ */
+void WebSocketsClient::onConnectAttempt(WebSocketClientAttemptEvent cbAttempt) {
+    _cbAttempt = cbAttempt;
 }
 
 bool WebSocketsClient::isConnected(void) {
@@ -474,15 +540,18 @@ void WebSocketsClient::messageReceived(WSclient_t * client, WSopcode_t opcode, u
 void WebSocketsClient::clientDisconnect(WSclient_t * client) {
     bool event = false;
 
-#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32)
+    if((client->status == WSC_HEADER || client->status == WSC_BODY) && _cbAttempt) {
+        _cbAttempt(false, _connectTime, millis() - _lastHeaderSent);
+    }
+
+#if defined(HAS_SSL) && ((WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX))
     if(client->isSSL && client->ssl) {
         if(client->ssl->connected()) {
             client->ssl->flush();
-            client->ssl->stop();
         }
-        event = true;
-        delete client->ssl;
-        client->ssl = NULL;
+        // stopped, not deleted, to connect with again
+        client->ssl->stop();
+        event       = true;
         client->tcp = NULL;
     }
 #endif
@@ -511,10 +580,16 @@ void WebSocketsClient::clientDisconnect(WSclient_t * client) {
     client->cIsWebsocket = false;
     client->cSessionId   = "";
 
+#if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
+    dropPendingRead(client);
+#endif
+    dropTxQueue(client);
+
     client->status      = WSC_NOT_CONNECTED;
+    _reconnectWait      = _reconnect.failed();
     _lastConnectionFail = millis();
 
-    DEBUG_WEBSOCKETS("[WS-Client] client disconnected.\n");
+    DEBUG_WEBSOCKETS("[WS-Client] client disconnected, reconnecting in %lu ms.\n", _reconnectWait);
     if(event) {
         runCbEvent(WStype_DISCONNECTED, NULL, 0);
     }
@@ -562,8 +637,9 @@ void WebSocketsClient::handleClientData(void) {
         return;
     }
 
+    // a frame that came in part way is read on as soon as there's more of it, or timed out
     int len = _client.tcp->available();
-    if(len > 0) {
+    if(len > 0 || _client.cRxLeft > 0) {
         switch(_client.status) {
             case WSC_HEADER: {
                 String headerLine = _client.tcp->readStringUntil('\n');
@@ -813,6 +889,11 @@ void WebSocketsClient::handleHeader(WSclient_t * client, String * headerLine) {
             DEBUG_WEBSOCKETS("[WS-Client][handleHeader] Websocket connection init done.\n");
             headerDone(client);
 
+            _reconnect.connected();
+            if(_cbAttempt) {
+                _cbAttempt(true, _connectTime, millis() - _lastHeaderSent);
+            }
+
             runCbEvent(WStype_CONNECTED, (uint8_t *)client->cUrl.c_str(), client->cUrl.length());
 #if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
         } else if(client->isSocketIO) {
@@ -863,7 +944,7 @@ void WebSocketsClient::connectedCb() {
     _client.tcp->setTimeout(WEBSOCKETS_TCP_TIMEOUT);
 #endif
 
-#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32)
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
     _client.tcp->setNoDelay(true);
 #endif
 
@@ -891,6 +972,9 @@ void WebSocketsClient::connectedCb() {
 
 void WebSocketsClient::connectFailedCb() {
     DEBUG_WEBSOCKETS("[WS-Client] connection to %s:%u Failed\n", _host.c_str(), _port);
+    if(_cbAttempt) {
+        _cbAttempt(false, _connectTime, 0);
+    }
 }
 
 #if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266_ASYNC)
@@ -972,3 +1056,61 @@ void WebSocketsClient::enableHeartbeat(uint32_t pingInterval, uint32_t pongTimeo
 void WebSocketsClient::disableHeartbeat() {
     _client.pingInterval = 0;
 }
+
+WebSocketsReconnect::WebSocketsReconnect(unsigned long base, unsigned long max) {
+    set(base, max);
+}
+
+/**
+ * @param base unsigned long ms waited at least, after the first retry
+ * @param max unsigned long ms waited at most
+ */
+void WebSocketsReconnect::set(unsigned long base, unsigned long max) {
+    _base = base;
+    _max  = max < base ? base : max;
+    reset();
+}
+
+/**
+ * forget the attempts so far, the next retry goes right away
+ */
+void WebSocketsReconnect::reset(void) {
+    _wait        = _base;
+    _connectedAt = 0;
+    _connected   = false;
+    _retried     = false;
+}
+
+/**
+ * the websocket connection is up
+ */
+void WebSocketsReconnect::connected(void) {
+    _connected   = true;
+    _connectedAt = millis();
+}
+
+/**
+ * an attempt failed or the connection was lost
+ * @return ms to wait before the next attempt
+ */
+unsigned long WebSocketsReconnect::failed(void) {
+    // a connection that came up only to be dropped again doesn't restart the backoff,
+    // or a server that drops every connection would be retried without a pause
+    if(_connected && (millis() - _connectedAt) >= _max) {
+        reset();
+    }
+    _connected = false;
+
+    if(!_retried) {
+        _retried = true;
+        return 0;
+    }
+
+    // decorrelated jitter, random between base and three times the last wait
+    unsigned long upper = _wait * 3;
+    if(upper > _max) {
+        upper = _max;
+    }
+    _wait = (upper > _base) ? (unsigned long)random(_base, upper + 1) : _base;
+    return _wait;
+}
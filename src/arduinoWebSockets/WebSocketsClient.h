@@ -27,12 +27,38 @@
 
 #include "WebSockets.h"
 
+/**
+ * how long the client waits before it connects again, after an attempt failed or the connection
+ * was lost. the first retry goes right away, later ones wait a random time between base and three
+ * times the last wait, up to max (decorrelated jitter), so clients that lost the server together
+ * don't come back in lockstep. once a connection held for max, the next loss starts over
+ */
+class WebSocketsReconnect {
+  public:
+    WebSocketsReconnect(unsigned long base = 500, unsigned long max = 500);
+
+    void set(unsigned long base, unsigned long max);
+    void reset(void);
+    void connected(void);
+    unsigned long failed(void);
+
+  private:
+    unsigned long _base;
+    unsigned long _max;
+    unsigned long _wait;           ///< last wait after the first retry
+    unsigned long _connectedAt;    ///< millis when the connection came up
+    bool _connected;               ///< the connection is up
+    bool _retried;                 ///< the first retry is done
+};
+
 class WebSocketsClient : protected WebSockets {
   public:
 #ifdef __AVR__
     typedef void (*WebSocketClientEvent)(WStype_t type, uint8_t * payload, size_t length);
+    typedef void (*WebSocketClientAttemptEvent)(bool connected, unsigned long connectTime, unsigned long handshakeTime);
 #else
     typedef std::function<void(WStype_t type, uint8_t * payload, size_t length)> WebSocketClientEvent;
+    typedef std::function<void(bool connected, unsigned long connectTime, unsigned long handshakeTime)> WebSocketClientAttemptEvent;
 #endif
 
     WebSocketsClient(void);
@@ -87,6 +113,10 @@ class WebSocketsClient : protected WebSockets {
     bool sendBIN(uint8_t * payload, size_t length, bool headerToPayload = false);
     bool sendBIN(const uint8_t * payload, size_t length);
 
+    bool sendFragment(WSopcode_t opcode, uint8_t * payload, size_t length, bool fin, bool headerToPayload = false);
+
+    size_t queuedBytes(void);
+
     bool sendPing(uint8_t * payload = NULL, size_t length = 0);
     bool sendPing(String & payload);
 
@@ -98,6 +128,8 @@ class WebSocketsClient : protected WebSockets {
     void setExtraHeaders(const char * extraHeaders = NULL);
 
     void setReconnectInterval(unsigned long time);
+    void setReconnectBackoff(unsigned long base, unsigned long max);
+    void onConnectAttempt(WebSocketClientAttemptEvent cbAttempt);
 
     void enableHeartbeat(uint32_t pingInterval, uint32_t pongTimeout, uint8_t disconnectTimeoutCount);
     void disableHeartbeat();
@@ -125,11 +157,17 @@ class WebSocketsClient : protected WebSockets {
 
 #endif
     WSclient_t _client;
+#ifdef WEBSOCKETS_NETWORK_SSL_SESSION_CLASS
+    WEBSOCKETS_NETWORK_SSL_SESSION_CLASS _session;    ///< offered again when reconnecting
+#endif
 
     WebSocketClientEvent _cbEvent;
+    WebSocketClientAttemptEvent _cbAttempt;
 
     unsigned long _lastConnectionFail;
-    unsigned long _reconnectInterval;
+    WebSocketsReconnect _reconnect;
+    unsigned long _reconnectWait;    ///< ms to wait after _lastConnectionFail
+    unsigned long _connectTime;      ///< ms the last tcp connect took
     unsigned long _lastHeaderSent;
 
     void messageReceived(WSclient_t * client, WSopcode_t opcode, uint8_t * payload, size_t length, bool fin);
@@ -80,6 +80,8 @@ void WebSocketsServerCore::begin(void) {
         _clients[i].init(i, _pingInterval, _pongTimeout, _disconnectTimeoutCount);
     }
 
+    _pool.reserve();
+
 #ifdef ESP8266
     randomSeed(RANDOM_REG32);
 #elif defined(ESP32)
@@ -240,6 +242,27 @@ bool WebSocketsServerCore::sendBIN(uint8_t num, const uint8_t * payload, size_t
     return sendBIN(num, (uint8_t *)payload, length);
 }
 
+/**
+ * send one frame of a fragmented message to client
+ * @param num uint8_t client id
+ * @param opcode WSopcode_t     WSop_text or WSop_binary for the first frame, WSop_continuation after it
+ * @param payload uint8_t *
+ * @param length size_t
+ * @param fin bool              set on the last frame of the message
+ * @param headerToPayload bool  (see sendFrame for more details)
+ * @return true if ok
+ */
+bool WebSocketsServerCore::sendFragment(uint8_t num, WSopcode_t opcode, uint8_t * payload, size_t length, bool fin, bool headerToPayload) {
+    if(num >= WEBSOCKETS_SERVER_CLIENT_MAX) {
+        return false;
+    }
+    WSclient_t * client = &_clients[num];
+    if(clientIsConnected(client)) {
+        return sendFrame(client, opcode, payload, length, fin, headerToPayload);
+    }
+    return false;
+}
+
 /**
  * send binary data to client all
  * @param payload uint8_t *
@@ -433,6 +456,8 @@ WSclient_t * WebSocketsServerCore::newClient(WEBSOCKETS_NETWORK_CLASS * TCPclien
 #if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32)
             client->isSSL = false;
             client->tcp->setNoDelay(true);
+#elif(WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
+            client->tcp->setNoDelay(true);
 #endif
 #if(WEBSOCKETS_NETWORK_TYPE != NETWORK_ESP8266_ASYNC)
             // set Timeout for readBytesUntil and readStringUntil
@@ -562,7 +587,10 @@ void WebSocketsServerCore::clientDisconnect(WSclient_t * client) {
 
 #if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266_ASYNC)
     client->cHttpLine = "";
+#else
+    dropPendingRead(client);
 #endif
+    dropTxQueue(client);
 
     client->status = WSC_NOT_CONNECTED;
 
@@ -631,7 +659,7 @@ WSclient_t * WebSocketsServerCore::handleNewClient(WEBSOCKETS_NETWORK_CLASS * tc
  * Handle incoming Connection Request
  */
 void WebSocketsServer::handleNewClients(void) {
-#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32)
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
     while(_server->hasClient()) {
 #endif
 
@@ -644,7 +672,7 @@ void WebSocketsServer::handleNewClients(void) {
 
         handleNewClient(tcpClient);
 
-#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32)
+#if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
     }
 #endif
 }
@@ -657,8 +685,11 @@ void WebSocketsServerCore::handleClientData(void) {
     for(uint8_t i = 0; i < WEBSOCKETS_SERVER_CLIENT_MAX; i++) {
         client = &_clients[i];
         if(clientIsConnected(client)) {
+            handleTxQueue(client);
+
+            // a frame that came in part way is read on as soon as there's more of it, or timed out
             int len = client->tcp->available();
-            if(len > 0) {
+            if(len > 0 || client->cRxLeft > 0) {
                 //DEBUG_WEBSOCKETS("[WS-Server][%d][handleClientData] len: %d\n", client->num, len);
                 switch(client->status) {
                     case WSC_HEADER: {
@@ -917,7 +948,7 @@ void WebSocketsServer::close(void) {
     WebSocketsServerCore::close();
 #if(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266)
     _server->close();
-#elif(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266_ASYNC)
+#elif(WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP32) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266_ASYNC) || (WEBSOCKETS_NETWORK_TYPE == NETWORK_POSIX)
     _server->end();
 #else
     // TODO how to close server?
@@ -68,6 +68,8 @@ class WebSocketsServerCore : protected WebSockets {
     bool sendBIN(uint8_t num, uint8_t * payload, size_t length, bool headerToPayload = false);
     bool sendBIN(uint8_t num, const uint8_t * payload, size_t length);
 
+    bool sendFragment(uint8_t num, WSopcode_t opcode, uint8_t * payload, size_t length, bool fin, bool headerToPayload = false);
+
     bool broadcastBIN(uint8_t * payload, size_t length, bool headerToPayload = false);
     bool broadcastBIN(const uint8_t * payload, size_t length);
 
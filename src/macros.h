@@ -11,18 +11,114 @@
 #include "debug.h"
 
 // Connection macros
+#ifndef GRANDEUR_URL
 #define GRANDEUR_URL "api.grandeur.tech"
+#endif
+#ifndef GRANDEUR_PORT
 #define GRANDEUR_PORT 443
+#endif
 #define GRANDEUR_FINGERPRINT NULL
+// Set to 0 to talk plain websockets, e.g. to a local stand-in server.
+#ifndef GRANDEUR_SSL
+#define GRANDEUR_SSL 1
+#endif
 
 // Strings sizes
 #define FINGERPRINT_SIZE 256
 #define MESSAGE_SIZE 512
+// Send buffer starts at MESSAGE_SIZE and doubles for larger messages up to this size. It's
+// shrunk back once they're sent.
+#ifndef MESSAGE_MAX_SIZE
+#define MESSAGE_MAX_SIZE (15 * 1024)
+#endif
+// While connected, a message that outgrows this size is printed and sent in fragments of it
+// instead of growing the send buffer, which takes messages of any size.
+#ifndef FRAGMENT_SIZE
+#define FRAGMENT_SIZE 1024
+#endif
+// Messages received in fragments are put back together in a buffer that grows up to this size
+// and is shrunk back to MESSAGE_SIZE after each of them. Larger ones are dropped.
+#ifndef RECEIVE_MAX_SIZE
+#define RECEIVE_MAX_SIZE (8 * 1024)
+#endif
+// Batched messages are sent early when they outgrow this size.
+#ifndef BATCH_SIZE
+#define BATCH_SIZE 2048
+#endif
 #define PING_MESSAGE_SIZE 64
 #define TASK_SIZE 32
 
-// Ping interval in milliseconds
+// Messages sent while duplex channel is down are buffered in BUFFER_SIZE bytes, up to
+// BUFFER_MESSAGES of them. BUFFER_OVERFLOW says what happens to messages beyond that:
+// BUFFER_DROP_OLDEST, BUFFER_DROP_NEWEST or BUFFER_REJECT. Either way, the callback of a
+// dropped message gets "BUFFER-FULL".
+#ifndef BUFFER_SIZE
+#define BUFFER_SIZE 4096
+#endif
+#ifndef BUFFER_MESSAGES
+#define BUFFER_MESSAGES 32
+#endif
+#ifndef BUFFER_OVERFLOW
+#define BUFFER_OVERFLOW BUFFER_DROP_OLDEST
+#endif
+// Number of paths device data sets are coalesced for by default.
+#define COALESCE_LIMIT 16
+
+// Subscription requests are kept to subscribe again after reconnecting. They are never dropped:
+// their buffer starts at SUBSCRIPTION_BUFFER_SIZE bytes for SUBSCRIPTION_BUFFER_MESSAGES requests
+// and grows up to the MAX sizes, past which new subscriptions are turned down.
+#ifndef SUBSCRIPTION_BUFFER_SIZE
+#define SUBSCRIPTION_BUFFER_SIZE 1024
+#endif
+#ifndef SUBSCRIPTION_BUFFER_MESSAGES
+#define SUBSCRIPTION_BUFFER_MESSAGES 16
+#endif
+#ifndef SUBSCRIPTION_BUFFER_MAX_SIZE
+#define SUBSCRIPTION_BUFFER_MAX_SIZE (16 * 1024)
+#endif
+#ifndef SUBSCRIPTION_BUFFER_MAX_MESSAGES
+#define SUBSCRIPTION_BUFFER_MAX_MESSAGES 128
+#endif
+
+// Requests waiting for a response at a time. More are answered with "TOO-MANY-REQUESTS".
+#ifndef REQUESTS_MAX
+#define REQUESTS_MAX 32
+#endif
+// Milliseconds a request waits for its response before it's answered with "REQUEST-TIMED-OUT".
+// Requests sent over a connection that drops before their responses come are answered with
+// "DISCONNECTED".
+#ifndef REQUEST_TIMEOUT
+#define REQUEST_TIMEOUT 15000
+#endif
+
+// cJSON builds the payloads of outgoing messages and parses incoming messages in a block of
+// this many bytes instead of making a heap allocation per node. 0 leaves it all to the heap.
+#ifndef JSON_ARENA_SIZE
+#define JSON_ARENA_SIZE 4096
+#endif
+
+// The first reconnect goes right away, later ones wait a random time of at least RECONNECT_MIN
+// milliseconds that grows with every failed attempt, up to RECONNECT_MAX.
+#ifndef RECONNECT_MIN
+#define RECONNECT_MIN 1000
+#endif
+#ifndef RECONNECT_MAX
+#define RECONNECT_MAX 30000
+#endif
+// Grandeur is pinged once nothing has been sent or received for this many milliseconds, to keep
+// the connection from being dropped as idle.
+#ifndef PING_INTERVAL
 #define PING_INTERVAL 25000
+#endif
+// With the websocket heartbeat, a pong that doesn't come within PONG_TIMEOUT milliseconds of its
+// ping, or half the ping interval if that's shorter, is missed. PONG_MISSES missed in a row drop
+// the connection.
+#ifndef PONG_TIMEOUT
+#define PONG_TIMEOUT 10000
+#endif
+#ifndef PONG_MISSES
+#define PONG_MISSES 2
+#endif
 
 // Macros for connection status
 #define DISCONNECTED false
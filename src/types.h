@@ -15,9 +15,7 @@
 #ifndef GRANDEURTYPES_H_
 #define GRANDEURTYPES_H_
 
-// Macro to generate an Id anywhere in the SDK.
-#define gid() micros();
-// Type of the generated Id.
+// Type of message ids.
 typedef unsigned long gId;
 
 // EventID
@@ -46,12 +44,4 @@ class Config {
     Config(String apiKey, String token) : apiKey(apiKey), token(token) {};
 };
 
-// Data structure to store data in Buffer.
-struct Message {
-  gId id;
-  String str; // Full packet containing task and payload after being stringified.
-
-  Message(gId id, String message) : id(id), str(message) {}
-};
-
 #endif
\ No newline at end of file